@@ -0,0 +1,187 @@
+#include "common/dependency/glm.hpp"
+#include "common/geometry/aabb.hpp"
+#include "common/occlusion/depth_buffer.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Rasterizes known triangles into the software depth buffer and checks the
+// depths and occlusion results, no GPU needed. Clip positions have 'w' = 1,
+// so depth is 'z * 0.5 + 0.5' and texel (x, y) is centered on
+// '((x + 0.5) / width * 2 - 1, (y + 0.5) / height * 2 - 1)'.
+
+static constexpr int width = 64;
+static constexpr int height = 32;
+
+static float depth_at(const occlusion::DepthBuffer& db, int x, int y) {
+    auto& l = db.levels.front();
+    return l.depth[std::size_t(y) * std::size_t(l.width) + std::size_t(x)];
+}
+
+static bool check(const std::string& name, bool passed) {
+    std::cout << "  " << name << (passed ? "" : "  FAILED") << '\n';
+    return passed;
+}
+
+// Corners of a clip space box.
+static Aabb box(glm::vec3 min, glm::vec3 max) {
+    auto b = Aabb();
+    extend(b, min);
+    extend(b, max);
+    return b;
+}
+
+static bool self_test() {
+    auto ok = true;
+    auto db = occlusion::depth_buffer(width, height);
+    std::cout << "Self test on a " << width << "x" << height
+        << " depth buffer, " << size(db.levels) << " levels:\n";
+
+    ok &= check("Cleared to the far plane", [&]() {
+        for(auto d : db.levels.front().depth) {
+            if(d != 1.f) {
+                return false;
+            }
+        }
+        return true;
+    }());
+
+    { // Lower left half of the screen, at depth '0.5 * fx + fy' for texel
+        // centers at '(fx, fy)' in [0, 1].
+        auto positions = std::vector<glm::vec4>{
+            {-1.f, -1.f, -1.f, 1.f},
+            {+1.f, -1.f, 0.f, 1.f},
+            {-1.f, +1.f, +1.f, 1.f},
+        };
+        auto indices = std::vector<std::uint32_t>{0, 1, 2};
+        auto count = occlusion::rasterize(db, positions, indices);
+        ok &= check("One triangle rasterized", count == 1);
+        ok &= check("Depth interpolated across the triangle", [&]() {
+            for(int y = 0; y < height; ++y) {
+                for(int x = 0; x < width; ++x) {
+                    auto fx = (float(x) + 0.5f) / float(width);
+                    auto fy = (float(y) + 0.5f) / float(height);
+                    auto expected = (fx + fy <= 1.f) ? 0.5f * fx + fy : 1.f;
+                    // Texels right on the edge may go either way.
+                    if(std::abs(fx + fy - 1.f) < 0.05f) {
+                        continue;
+                    }
+                    if(std::abs(depth_at(db, x, y) - expected) > 1e-4f) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }());
+    }
+    { // Screen quad at depth 0.5, opposite windings.
+        auto positions = std::vector<glm::vec4>{
+            {-1.f, -1.f, 0.f, 1.f},
+            {+1.f, -1.f, 0.f, 1.f},
+            {+1.f, +1.f, 0.f, 1.f},
+            {-1.f, +1.f, 0.f, 1.f},
+        };
+        auto indices = std::vector<std::uint32_t>{0, 1, 2, 0, 3, 2};
+        auto count = occlusion::rasterize(db, positions, indices);
+        ok &= check("Both windings rasterized", count == 2);
+        ok &= check("Nearest depth kept", [&]() {
+            for(int y = 0; y < height; ++y) {
+                for(int x = 0; x < width; ++x) {
+                    auto fx = (float(x) + 0.5f) / float(width);
+                    auto fy = (float(y) + 0.5f) / float(height);
+                    auto expected = std::min(0.5f * fx + fy, 0.5f);
+                    if(std::abs(depth_at(db, x, y) - expected) > 1e-4f) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }());
+        ok &= check("Lower left corner in front", depth_at(db, 0, 0) < 0.05f);
+        ok &= check("Upper right corner at the quad",
+            depth_at(db, width - 1, height - 1) == 0.5f);
+    }
+    { // Behind the camera.
+        auto positions = std::vector<glm::vec4>{
+            {-1.f, -1.f, -0.5f, -1.f},
+            {+1.f, -1.f, -0.5f, 1.f},
+            {-1.f, +1.f, -0.5f, 1.f},
+        };
+        auto indices = std::vector<std::uint32_t>{0, 1, 2};
+        auto count = occlusion::rasterize(db, positions, indices);
+        ok &= check("Triangle crossing the near plane skipped", count == 0);
+    }
+    { // In front of the camera, one vertex past the near plane at 'z' = -'w'.
+        auto positions = std::vector<glm::vec4>{
+            {-1.f, -1.f, -1.5f, 1.f},
+            {+1.f, -1.f, -0.5f, 1.f},
+            {+1.f, +1.f, -0.5f, 1.f},
+        };
+        auto indices = std::vector<std::uint32_t>{0, 1, 2};
+        auto count = occlusion::rasterize(db, positions, indices);
+        ok &= check("Triangle straddling the near plane skipped", count == 0);
+        ok &= check("No depth nearer than the near plane", [&]() {
+            for(auto d : db.levels.front().depth) {
+                if(d < 0.f) {
+                    return false;
+                }
+            }
+            return true;
+        }());
+    }
+
+    occlusion::build_pyramid(db);
+    ok &= check("Top of the pyramid is the farthest depth", [&]() {
+        auto& top = db.levels.back();
+        return top.width == 1 and top.height == 1 and top.depth[0] == 0.5f;
+    }());
+
+    auto world_to_clip = glm::mat4(1.f);
+    // Depth 0.8 to 0.9 over the whole screen.
+    ok &= check("Box behind the quad occluded", occlusion::is_occluded(db,
+        box({-0.9f, -0.9f, 0.6f}, {0.9f, 0.9f, 0.8f}), world_to_clip));
+    // Depth 0.1 to 0.2.
+    ok &= check("Box in front of the quad visible", not occlusion::is_occluded(db,
+        box({-0.5f, -0.5f, -0.8f}, {0.5f, 0.5f, -0.6f}), world_to_clip));
+    // Depth 0.45 to 0.48, only behind the triangle near the lower left corner.
+    ok &= check("Box behind the triangle occluded", occlusion::is_occluded(db,
+        box({-1.f, -1.f, -0.1f}, {-0.8f, -0.8f, -0.04f}), world_to_clip));
+    ok &= check("Box in front of the quad but not the triangle visible",
+        not occlusion::is_occluded(db,
+            box({0.5f, 0.5f, -0.1f}, {0.9f, 0.9f, -0.04f}), world_to_clip));
+    ok &= check("Box off screen never occluded", not occlusion::is_occluded(db,
+        box({1.5f, 1.5f, 0.6f}, {2.f, 2.f, 0.8f}), world_to_clip));
+    {
+        // Corners with 'w' = 1 - z, the far ones behind the camera.
+        auto perspective = glm::mat4(1.f);
+        perspective[2][3] = -1.f;
+        ok &= check("Box crossing the near plane never occluded",
+            not occlusion::is_occluded(db,
+                box({-0.5f, -0.5f, 0.5f}, {0.5f, 0.5f, 1.5f}), perspective));
+    }
+    return ok;
+}
+
+void throwing_main() {
+    if(not self_test()) {
+        throw std::runtime_error("Self test failed.");
+    }
+}
+
+int main() {
+    try {
+        throwing_main();
+        return 0;
+    } catch(const std::exception& e) {
+        std::cerr << "std::exception: " << e.what() << std::endl;
+        return -1;
+    } catch(...) {
+        std::cerr << "Unhandled exception." << std::endl;
+        return -1;
+    }
+}
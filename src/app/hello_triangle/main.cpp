@@ -87,8 +87,11 @@ void throwing_main() {
         scheduler.on_init = [&]() {
             init(app);
         };
+        scheduler.on_input = [&]() {
+            glfwPollEvents();
+        };
         scheduler.time_per_render = 1.f / 60.f;
-        scheduler.on_render = [&]() {
+        scheduler.on_render = [&](float) {
             
 
             ImGui_ImplOpenGL3_NewFrame();
@@ -116,8 +119,6 @@ void throwing_main() {
         };
         scheduler.time_per_update = 1.f / 60.f;
         scheduler.on_update = [&]() {
-            glfwPollEvents();
-
             update(app);
         };
         run(scheduler);
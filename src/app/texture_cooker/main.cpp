@@ -0,0 +1,158 @@
+// Decoders of 'common/image/decode.hpp'.
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "common/filesystem/mapped_file.hpp"
+#include "common/image/block_compression.hpp"
+#include "common/image/decode.hpp"
+#include "common/texture_cache/texture_cache.hpp"
+#include "common/thread/thread_pool.hpp"
+#include "common/time/clock.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Peak signal to noise ratio of the channels used by 'format', in dB.
+static double psnr(
+    const image::Rgba8& a,
+    const image::Rgba8& b,
+    image::BlockFormat format)
+{
+    auto channels = (format == image::BlockFormat::bc1) ? 3 : 4;
+    auto squared_error = 0.;
+    auto count = std::size_t(0);
+    for(std::size_t i = 0; i < size(a.pixels); ++i) {
+        if(int(i % 4) < channels) {
+            auto e = double(a.pixels[i]) - double(b.pixels[i]);
+            squared_error += e * e;
+            count += 1;
+        }
+    }
+    if(squared_error == 0.) {
+        return INFINITY;
+    }
+    return 10. * std::log10(255. * 255. * double(count) / squared_error);
+}
+
+// Smooth gradients with noise and a translucent disc, every format is
+// expected to stay above a few tens of dB on it.
+static image::Rgba8 synthetic(int width, int height) {
+    auto rng = std::mt19937(42);
+    auto noise = std::uniform_int_distribution<int>(-3, 3);
+    auto i = image::rgba8(width, height);
+    for(int y = 0; y < height; ++y) {
+        for(int x = 0; x < width; ++x) {
+            auto p = i.pixels.data() + 4 * (std::size_t(y) * std::size_t(width) + std::size_t(x));
+            auto dx = float(x - width / 2);
+            auto dy = float(y - height / 2);
+            auto inside = dx * dx + dy * dy < float(width * height) / 8.f;
+            auto value = [&](int v) {
+                return std::uint8_t(std::clamp(v + noise(rng), 0, 255));
+            };
+            p[0] = value(255 * x / width);
+            p[1] = value(255 * y / height);
+            p[2] = value(inside ? 200 : 40);
+            p[3] = value(inside ? 128 : 255);
+        }
+    }
+    return i;
+}
+
+// Compresses and decompresses a synthetic image in every format.
+static bool self_test(ThreadPool& pool) {
+    auto source = synthetic(509, 253);
+    auto ok = true;
+    std::cout << "Self test on a " << source.width << "x" << source.height
+        << " synthetic image:\n";
+    for(std::size_t f = 0; f < image::block_format_count; ++f) {
+        auto format = image::BlockFormat(f);
+        auto clock = Clock();
+        auto compressed = image::block_image(source.width, source.height, format);
+        pool.parallel_for(std::size_t(image::block_count(source.height)),
+            [&](std::size_t row) {
+                image::compress_rows(source, compressed, int(row), int(row) + 1);
+            });
+        auto seconds = clock.restart().count();
+        auto quality = psnr(source, image::decompress(compressed), format);
+        auto passed = quality > 30.;
+        ok = ok and passed;
+        std::cout << "  " << std::left << std::setw(4) << image::block_format_names[f]
+            << std::right << std::fixed << std::setprecision(2)
+            << std::setw(8) << quality << " dB"
+            << std::setw(10) << float(size_bytes(source)) / 1e6f / seconds << " MB/s"
+            << (passed ? "" : "  FAILED") << '\n';
+    }
+    return ok;
+}
+
+void throwing_main(int argc, char** argv) {
+    auto pool = ThreadPool();
+    if(argc < 3) {
+        std::cout << "Usage: texture_cooker <cache directory> <image>...\n";
+        if(not self_test(pool)) {
+            throw std::runtime_error("Self test failed.");
+        }
+        return;
+    }
+    auto directory = std::filesystem::path(argv[1]);
+    auto source_bytes = std::size_t(0);
+    auto total = Clock();
+    for(int ai = 2; ai < argc; ++ai) {
+        auto source_path = std::filesystem::path(argv[ai]);
+        auto clock = Clock();
+        auto file = filesystem::MappedFile(source_path);
+        auto hash = texture_cache::source_hash(file.bytes());
+        auto cache_path = texture_cache::path(directory, hash);
+        if(texture_cache::Reader::open(cache_path, hash)) {
+            std::cout << source_path.string() << ": up to date.\n";
+            continue;
+        }
+        auto bytes = texture_cache::cook(file.bytes(), std::nullopt, &pool);
+        auto cook_seconds = clock.restart().count();
+        texture_cache::write(cache_path, bytes);
+        auto cooked = texture_cache::Reader::from_bytes(std::move(bytes), hash);
+        auto& h = cooked->header();
+        // Base level against the source.
+        auto& base = cooked->levels().front();
+        auto compressed = image::block_image(int(base.width), int(base.height), h.format);
+        auto blocks = cooked->blocks(base);
+        std::memcpy(compressed.blocks.data(), blocks.data(), size(blocks));
+        auto quality = psnr(image::decode(file.bytes()),
+            image::decompress(compressed), h.format);
+        source_bytes += file.size();
+        std::cout << source_path.string() << ": " << h.width << "x" << h.height
+            << ", " << h.level_count << " levels, "
+            << image::block_format_names[std::size_t(h.format)]
+            << std::fixed << std::setprecision(2)
+            << ", " << float(cooked->block_size()) / float(1 << 20) << " MiB"
+            << " (RGBA8: " << 4.f / 3.f * float(4 * h.width * h.height) / float(1 << 20) << " MiB)"
+            << ", " << quality << " dB"
+            << ", " << 1000.f * cook_seconds << " ms -> "
+            << cache_path.string() << '\n';
+    }
+    auto seconds = total.restart().count();
+    std::cout << "Cooked on " << pool.size() + 1 << " threads, "
+        << float(source_bytes) / 1e6f / seconds << " MB/s of source.\n";
+}
+
+int main(int argc, char** argv) {
+    try {
+        throwing_main(argc, argv);
+        return 0;
+    } catch(const std::exception& e) {
+        std::cerr << "std::exception: " << e.what() << std::endl;
+        return -1;
+    } catch(...) {
+        std::cerr << "Unhandled exception." << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,144 @@
+#include "common/dependency/glm.hpp"
+#include "common/time/clock.hpp"
+#include "common/transform/kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Random hierarchy in topological order with affine local transforms.
+struct Hierarchy {
+    std::vector<std::uint32_t> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<float> affine_locals;
+};
+
+static Hierarchy hierarchy(std::size_t node_count) {
+    auto h = Hierarchy();
+    auto rng = std::mt19937(42);
+    auto value = std::uniform_real_distribution<float>(-1.f, 1.f);
+    h.parents.resize(node_count);
+    h.locals.resize(node_count);
+    h.affine_locals.resize(12 * node_count);
+    for(std::size_t i = 0; i < node_count; ++i) {
+        // A few roots, otherwise shallow and wide like an imported scene.
+        h.parents[i] = (i % 64 == 0)
+            ? transform::no_parent
+            : std::uint32_t(i - 1 - rng() % std::min<std::size_t>(i, 16));
+        auto& m = h.locals[i];
+        m = glm::mat4(1.f);
+        for(int c = 0; c < 4; ++c) {
+            for(int r = 0; r < 3; ++r) {
+                m[c][r] = (c == r ? 1.f : 0.f) + 0.1f * value(rng);
+                h.affine_locals[12 * i + 3 * c + r] = m[c][r];
+            }
+        }
+    }
+    return h;
+}
+
+// Calls 'f' until at least 0.2 s elapsed, returns nanoseconds per node.
+template<typename F>
+double measure(std::size_t node_count, F f) {
+    f();
+    auto clock = Clock();
+    auto iterations = std::size_t(0);
+    auto seconds = 0.;
+    while(seconds < 0.2) {
+        f();
+        iterations += 1;
+        seconds += clock.restart().count();
+    }
+    return 1e9 * seconds / double(iterations * node_count);
+}
+
+static float max_difference(
+    const std::vector<glm::mat4>& a,
+    const std::vector<glm::mat4>& b)
+{
+    auto d = 0.f;
+    for(std::size_t i = 0; i < size(a); ++i) {
+        for(int c = 0; c < 4; ++c) {
+            for(int r = 0; r < 4; ++r) {
+                d = std::max(d, std::abs(a[i][c][r] - b[i][c][r]));
+            }
+        }
+    }
+    return d;
+}
+
+void throwing_main() {
+    auto world_to_clip = glm::perspective(1.5f, 16.f / 9.f, 0.1f, 1000.f)
+        * glm::translate(glm::mat4(1.f), glm::vec3(1.f, 2.f, 3.f));
+    std::cout << std::fixed << std::setprecision(2)
+        << "World and clip transforms, ns per node (best ISA: "
+        << transform::isa_names[std::size_t(transform::best_isa())] << ").\n";
+    for(std::size_t node_count : {1'000, 10'000, 100'000}) {
+        auto h = hierarchy(node_count);
+        auto reference_worlds = std::vector<glm::mat4>(node_count);
+        auto reference_clips = std::vector<glm::mat4>(node_count);
+        auto glm_ns = measure(node_count, [&]() {
+            for(std::size_t i = 0; i < node_count; ++i) {
+                auto parent = h.parents[i];
+                reference_worlds[i] = (parent == transform::no_parent)
+                    ? h.locals[i]
+                    : reference_worlds[parent] * h.locals[i];
+                reference_clips[i] = world_to_clip * reference_worlds[i];
+            }
+        });
+        std::cout << node_count << " nodes:\n"
+            << "  glm:             " << std::setw(8) << glm_ns << '\n';
+        for(std::size_t isa = 0; isa < transform::isa_count; ++isa) {
+            if(not transform::is_supported(transform::Isa(isa))) {
+                continue;
+            }
+            auto& k = transform::kernels(transform::Isa(isa));
+            auto dirty = std::vector<std::uint8_t>(node_count);
+            auto worlds = std::vector<glm::mat4>(node_count);
+            auto clips = std::vector<glm::mat4>(node_count);
+            for(bool affine : {false, true}) {
+                auto ns = measure(node_count, [&]() {
+                    std::fill(begin(dirty), end(dirty), std::uint8_t(1));
+                    if(affine) {
+                        k.propagate_affine(h.parents.data(), h.affine_locals.data(),
+                            dirty.data(), &worlds[0][0][0], node_count);
+                    } else {
+                        k.propagate(h.parents.data(), &h.locals[0][0][0],
+                            dirty.data(), &worlds[0][0][0], node_count);
+                    }
+                    k.multiply(&world_to_clip[0][0], &worlds[0][0][0],
+                        &clips[0][0][0], node_count);
+                });
+                auto name = std::string(transform::isa_names[isa])
+                    + (affine ? " (3x4):" : ":");
+                std::cout << "  " << std::left << std::setw(17) << name
+                    << std::right << std::setw(8) << ns
+                    << "  x" << glm_ns / ns
+                    << std::scientific << std::setprecision(1)
+                    << "  max error " << std::max(
+                        max_difference(worlds, reference_worlds),
+                        max_difference(clips, reference_clips))
+                    << std::fixed << std::setprecision(2) << '\n';
+            }
+        }
+    }
+}
+
+int main() {
+    try {
+        throwing_main();
+        return 0;
+    } catch(const std::exception& e) {
+        std::cerr << "std::exception: " << e.what() << std::endl;
+        return -1;
+    } catch(...) {
+        std::cerr << "Unhandled exception." << std::endl;
+        return -1;
+    }
+}
@@ -1,3 +1,5 @@
 #pragma once
 
+#include "mapped_file.hpp"
 #include "recursive_path.hpp"
+#include "write_file.hpp"
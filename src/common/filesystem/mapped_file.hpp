@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace filesystem {
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    void unmap() noexcept {
+        if(data_ != nullptr) {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            munmap(const_cast<std::byte*>(data_), size_);
+#endif
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+public:
+    MappedFile() = default;
+
+    explicit
+    MappedFile(const std::filesystem::path& path) {
+        auto error = std::runtime_error(
+            "Failed to map \"" + path.string() + "\".");
+        size_ = std::size_t(std::filesystem::file_size(path));
+        if(size_ == 0) {
+            return;
+        }
+#ifdef _WIN32
+        auto file = CreateFileW(path.c_str(),
+            GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if(file == INVALID_HANDLE_VALUE) {
+            throw error;
+        }
+        auto mapping = CreateFileMappingW(file,
+            NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if(mapping == NULL) {
+            throw error;
+        }
+        data_ = static_cast<const std::byte*>(
+            MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        if(data_ == nullptr) {
+            throw error;
+        }
+#else
+        auto fd = open(path.c_str(), O_RDONLY);
+        if(fd == -1) {
+            throw error;
+        }
+        auto address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(address == MAP_FAILED) {
+            throw error;
+        }
+        data_ = static_cast<const std::byte*>(address);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0))
+    {}
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if(this != &other) {
+            unmap();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    std::span<const std::byte> bytes() const noexcept {
+        return {data_, size_};
+    }
+
+    const std::byte* data() const noexcept {
+        return data_;
+    }
+
+    std::size_t size() const noexcept {
+        return size_;
+    }
+};
+
+}
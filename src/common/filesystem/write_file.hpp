@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+
+namespace filesystem {
+
+// Written to a temporary file first so that an interrupted write
+// never leaves a truncated file behind.
+inline
+void write_file(
+    const std::filesystem::path& path,
+    std::span<const std::byte> bytes)
+{
+    if(path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    auto temporary_path = std::filesystem::path(path) += ".tmp";
+    {
+        auto file = std::ofstream(temporary_path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(bytes.data()),
+            std::streamsize(bytes.size()));
+        if(not file) {
+            throw std::runtime_error(
+                "Failed to write \"" + temporary_path.string() + "\".");
+        }
+    }
+    std::filesystem::rename(temporary_path, path);
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "common/dependency/glm.hpp"
+
+#include <cmath>
+#include <limits>
+
+// Axis aligned bounding box, empty by default.
+struct Aabb {
+    glm::vec3 min = glm::vec3(+std::numeric_limits<float>::infinity());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+};
+
+inline
+bool is_empty(const Aabb& b) {
+    return b.min.x > b.max.x or b.min.y > b.max.y or b.min.z > b.max.z;
+}
+
+inline
+void extend(Aabb& b, const glm::vec3& p) {
+    b.min = glm::min(b.min, p);
+    b.max = glm::max(b.max, p);
+}
+
+inline
+void extend(Aabb& b, const Aabb& other) {
+    b.min = glm::min(b.min, other.min);
+    b.max = glm::max(b.max, other.max);
+}
+
+inline
+glm::vec3 center(const Aabb& b) {
+    return (b.min + b.max) * 0.5f;
+}
+
+inline
+glm::vec3 extent(const Aabb& b) {
+    return b.max - b.min;
+}
+
+// Bounds of 'b' transformed by the affine 'm'.
+inline
+Aabb transformed(const Aabb& b, const glm::mat4& m) {
+    if(is_empty(b)) {
+        return b;
+    }
+    auto c = glm::vec3(m * glm::vec4(center(b), 1.f));
+    auto h = extent(b) * 0.5f;
+    auto e = glm::vec3(0.f);
+    for(int col = 0; col < 3; ++col) {
+        for(int row = 0; row < 3; ++row) {
+            e[row] += std::abs(m[col][row]) * h[col];
+        }
+    }
+    return {c - e, c + e};
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "bvh4.hpp"
+#include "frustum.hpp"
@@ -0,0 +1,315 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "frustum.hpp"
+
+#include "common/dependency/glm.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <span>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BVH4_SSE 1
+#include <immintrin.h>
+#endif
+
+// Four children per node with their bounds stored as structure of arrays,
+// so one node is tested against a plane with one SIMD instruction per axis.
+struct Bvh4Node {
+    float min_x[4];
+    float min_y[4];
+    float min_z[4];
+    float max_x[4];
+    float max_y[4];
+    float max_z[4];
+    // Node index when 'counts[i] == 0', else first of 'Bvh4::items'.
+    // Built with single item leaves, so every item is tested on its own.
+    std::uint32_t children[4];
+    std::uint32_t counts[4];
+};
+
+inline constexpr std::uint32_t bvh4_empty_child
+= std::numeric_limits<std::uint32_t>::max();
+
+// Parents precede their children in 'nodes', the root is first.
+struct Bvh4 {
+    std::vector<Bvh4Node> nodes;
+    // Item indices grouped by leaf.
+    std::vector<std::uint32_t> items;
+};
+
+inline
+void set_child_bounds(Bvh4Node& n, int i, const Aabb& b) {
+    n.min_x[i] = b.min.x;
+    n.min_y[i] = b.min.y;
+    n.min_z[i] = b.min.z;
+    n.max_x[i] = b.max.x;
+    n.max_y[i] = b.max.y;
+    n.max_z[i] = b.max.z;
+}
+
+inline
+Aabb child_bounds(const Bvh4Node& n, int i) {
+    return {
+        glm::vec3(n.min_x[i], n.min_y[i], n.min_z[i]),
+        glm::vec3(n.max_x[i], n.max_y[i], n.max_z[i])};
+}
+
+inline
+Aabb bounds(const Bvh4Node& n) {
+    auto b = Aabb();
+    for(int i = 0; i < 4; ++i) {
+        if(n.children[i] != bvh4_empty_child) {
+            extend(b, child_bounds(n, i));
+        }
+    }
+    return b;
+}
+
+// Bounds of 'items[first, first + count)'.
+inline
+Aabb leaf_bounds(
+    const Bvh4& bvh,
+    std::span<const Aabb> item_bounds,
+    std::size_t first,
+    std::size_t count)
+{
+    auto b = Aabb();
+    for(std::size_t i = first; i < first + count; ++i) {
+        extend(b, item_bounds[bvh.items[i]]);
+    }
+    return b;
+}
+
+// Recomputes node bounds from 'item_bounds', the topology is kept.
+inline
+void refit(Bvh4& bvh, std::span<const Aabb> item_bounds) {
+    // Children follow their parents, so a reverse pass is bottom up.
+    for(auto ni = size(bvh.nodes); ni-- > 0;) {
+        auto& n = bvh.nodes[ni];
+        for(int i = 0; i < 4; ++i) {
+            if(n.children[i] == bvh4_empty_child) {
+                continue;
+            }
+            set_child_bounds(n, i, (n.counts[i] > 0)
+                ? leaf_bounds(bvh, item_bounds, n.children[i], n.counts[i])
+                : bounds(bvh.nodes[n.children[i]]));
+        }
+    }
+}
+
+// Top down median splits on the largest centroid axis, two levels per node.
+// Up to four items share a node, one per child.
+inline
+Bvh4 bvh4(std::span<const Aabb> item_bounds) {
+    auto bvh = Bvh4();
+    bvh.items.resize(size(item_bounds));
+    for(std::size_t i = 0; i < size(item_bounds); ++i) {
+        bvh.items[i] = std::uint32_t(i);
+    }
+    if(item_bounds.empty()) {
+        return bvh;
+    }
+    // Splits 'items[first, last)' in two halves, returns the middle.
+    auto split = [&](std::size_t first, std::size_t last) {
+        auto centroids = Aabb();
+        for(auto i = first; i < last; ++i) {
+            extend(centroids, center(item_bounds[bvh.items[i]]));
+        }
+        auto e = extent(centroids);
+        auto axis = (e.x >= e.y and e.x >= e.z) ? 0 : (e.y >= e.z ? 1 : 2);
+        auto middle = first + (last - first) / 2;
+        std::nth_element(
+            begin(bvh.items) + first,
+            begin(bvh.items) + middle,
+            begin(bvh.items) + last,
+            [&](std::uint32_t a, std::uint32_t b) {
+                return center(item_bounds[a])[axis] < center(item_bounds[b])[axis];
+            });
+        return middle;
+    };
+    struct Range {
+        std::size_t node;
+        std::size_t first;
+        std::size_t last;
+    };
+    auto stack = std::vector<Range>();
+    bvh.nodes.emplace_back();
+    stack.push_back({0, 0, size(item_bounds)});
+    while(not stack.empty()) {
+        auto r = stack.back();
+        stack.pop_back();
+        // Up to four child ranges, single items become leaves.
+        std::size_t ranges[5] = {r.first, r.last, r.last, r.last, r.last};
+        auto range_count = 1;
+        if(r.last - r.first <= 4) {
+            range_count = int(r.last - r.first);
+            for(int i = 0; i <= range_count; ++i) {
+                ranges[i] = r.first + i;
+            }
+        } else {
+            auto middle = split(r.first, r.last);
+            ranges[1] = middle;
+            ranges[2] = r.last;
+            range_count = 2;
+            if(middle - r.first > 1 and r.last - middle > 1) {
+                ranges[1] = split(r.first, middle);
+                ranges[2] = middle;
+                ranges[3] = split(middle, r.last);
+                ranges[4] = r.last;
+                range_count = 4;
+            }
+        }
+        auto node = Bvh4Node();
+        for(int i = 0; i < 4; ++i) {
+            node.children[i] = bvh4_empty_child;
+            node.counts[i] = 0;
+            set_child_bounds(node, i, Aabb());
+        }
+        for(int i = 0; i < range_count; ++i) {
+            auto first = ranges[i];
+            auto last = ranges[i + 1];
+            if(last - first == 1) {
+                node.children[i] = std::uint32_t(first);
+                node.counts[i] = 1;
+            } else {
+                node.children[i] = std::uint32_t(size(bvh.nodes));
+                bvh.nodes.emplace_back();
+                stack.push_back({node.children[i], first, last});
+            }
+        }
+        bvh.nodes[r.node] = node;
+    }
+    refit(bvh, item_bounds);
+    return bvh;
+}
+
+// Bit 'i' of 'inside' when child 'i' may intersect 'f', bit 'i' of
+// 'contained' when it is entirely inside, so its subtree needs no test.
+struct Bvh4Test {
+    unsigned inside;
+    unsigned contained;
+};
+
+inline
+Bvh4Test test(const Bvh4Node& n, const Frustum& f) {
+#ifdef BVH4_SSE
+    auto min_x = _mm_loadu_ps(n.min_x);
+    auto min_y = _mm_loadu_ps(n.min_y);
+    auto min_z = _mm_loadu_ps(n.min_z);
+    auto max_x = _mm_loadu_ps(n.max_x);
+    auto max_y = _mm_loadu_ps(n.max_y);
+    auto max_z = _mm_loadu_ps(n.max_z);
+    auto outside = _mm_setzero_ps();
+    auto crossing = _mm_setzero_ps();
+    auto zero = _mm_setzero_ps();
+    for(auto& p : f.planes) {
+        auto a = _mm_set1_ps(p.x);
+        auto b = _mm_set1_ps(p.y);
+        auto c = _mm_set1_ps(p.z);
+        // Farthest and nearest corners along the plane normal.
+        auto far_d = _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(a, p.x > 0.f ? max_x : min_x),
+                _mm_mul_ps(b, p.y > 0.f ? max_y : min_y)),
+            _mm_add_ps(
+                _mm_mul_ps(c, p.z > 0.f ? max_z : min_z),
+                _mm_set1_ps(p.w)));
+        auto near_d = _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(a, p.x > 0.f ? min_x : max_x),
+                _mm_mul_ps(b, p.y > 0.f ? min_y : max_y)),
+            _mm_add_ps(
+                _mm_mul_ps(c, p.z > 0.f ? min_z : max_z),
+                _mm_set1_ps(p.w)));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(far_d, zero));
+        crossing = _mm_or_ps(crossing, _mm_cmplt_ps(near_d, zero));
+    }
+    // Empty slots have inverted bounds, '0 * inf' could let them through.
+    auto valid = _mm_cmple_ps(min_x, max_x);
+    auto inside = unsigned(_mm_movemask_ps(_mm_andnot_ps(outside, valid)));
+    auto contained = unsigned(_mm_movemask_ps(_mm_andnot_ps(crossing, valid)));
+    return {inside, contained & inside};
+#else
+    auto t = Bvh4Test{0, 0};
+    for(int i = 0; i < 4; ++i) {
+        auto b = child_bounds(n, i);
+        if(is_empty(b) or not intersects(f, b)) {
+            continue;
+        }
+        t.inside |= 1u << i;
+        auto is_contained = true;
+        for(auto& p : f.planes) {
+            auto nearest = glm::vec3(
+                p.x > 0.f ? b.min.x : b.max.x,
+                p.y > 0.f ? b.min.y : b.max.y,
+                p.z > 0.f ? b.min.z : b.max.z);
+            if(p.x * nearest.x + p.y * nearest.y + p.z * nearest.z + p.w < 0.f) {
+                is_contained = false;
+            }
+        }
+        if(is_contained) {
+            t.contained |= 1u << i;
+        }
+    }
+    return t;
+#endif
+}
+
+struct Bvh4CullStats {
+    std::size_t node_tests = 0;
+};
+
+// Calls 'f(item)' for every item whose bounds may intersect 'frustum'.
+template<typename F>
+Bvh4CullStats cull(const Bvh4& bvh, const Frustum& frustum, F&& f) {
+    auto stats = Bvh4CullStats();
+    if(bvh.nodes.empty()) {
+        return stats;
+    }
+    auto visit_all = [&](std::uint32_t root) {
+        auto stack = std::vector<std::uint32_t>{root};
+        while(not stack.empty()) {
+            auto& n = bvh.nodes[stack.back()];
+            stack.pop_back();
+            for(int i = 0; i < 4; ++i) {
+                if(n.children[i] == bvh4_empty_child) {
+                    continue;
+                }
+                if(n.counts[i] > 0) {
+                    for(std::uint32_t k = 0; k < n.counts[i]; ++k) {
+                        f(bvh.items[n.children[i] + k]);
+                    }
+                } else {
+                    stack.push_back(n.children[i]);
+                }
+            }
+        }
+    };
+    auto stack = std::vector<std::uint32_t>{0};
+    while(not stack.empty()) {
+        auto& n = bvh.nodes[stack.back()];
+        stack.pop_back();
+        auto t = test(n, frustum);
+        stats.node_tests += 1;
+        for(int i = 0; i < 4; ++i) {
+            if(not (t.inside & (1u << i))) {
+                continue;
+            }
+            if(n.counts[i] > 0) {
+                for(std::uint32_t k = 0; k < n.counts[i]; ++k) {
+                    f(bvh.items[n.children[i] + k]);
+                }
+            } else if(t.contained & (1u << i)) {
+                visit_all(n.children[i]);
+            } else {
+                stack.push_back(n.children[i]);
+            }
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "aabb.hpp"
+
+#include "common/dependency/glm.hpp"
+
+// Planes '(n, d)' with 'dot(n, p) + d >= 0' inside, not normalized.
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// Planes of the clip volume of 'world_to_clip', in world space.
+inline
+Frustum frustum(const glm::mat4& world_to_clip) {
+    auto row = [&](int r) {
+        return glm::vec4(
+            world_to_clip[0][r],
+            world_to_clip[1][r],
+            world_to_clip[2][r],
+            world_to_clip[3][r]);
+    };
+    auto f = Frustum();
+    f.planes[0] = row(3) + row(0);
+    f.planes[1] = row(3) - row(0);
+    f.planes[2] = row(3) + row(1);
+    f.planes[3] = row(3) - row(1);
+    f.planes[4] = row(3) + row(2);
+    f.planes[5] = row(3) - row(2);
+    return f;
+}
+
+// Conservative, boxes crossing the corner of two planes may be kept.
+inline
+bool intersects(const Frustum& f, const Aabb& b) {
+    for(auto& p : f.planes) {
+        auto farthest = glm::vec3(
+            p.x > 0.f ? b.max.x : b.min.x,
+            p.y > 0.f ? b.max.y : b.min.y,
+            p.z > 0.f ? b.max.z : b.min.z);
+        if(p.x * farthest.x + p.y * farthest.y + p.z * farthest.z + p.w < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
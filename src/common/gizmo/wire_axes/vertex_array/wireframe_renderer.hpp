@@ -1,42 +1,34 @@
 #pragma once
 
 #include "../wire_axes.hpp"
+#include "common/opengl/vertex_layout.hpp"
 #include "glsl/wireframe_renderer/wireframe_renderer.hpp"
 
+// Colors at binding 0, positions at binding 1.
+inline constexpr auto wire_axes_layout = VertexLayout<2, 2>{
+    .attributes = {{
+        {"a_color", 0, GL_FLOAT, 3, false, 0, 0},
+        {"a_position", 1, GL_FLOAT, 3, false, 0, 1},
+    }},
+    .strides = {GLsizei(sizeof(glm::vec3)), GLsizei(sizeof(glm::vec3))},
+};
+
+static_assert(is_valid(wire_axes_layout)
+    and matches(wire_axes_layout, wireframe_inputs));
+
 inline
-gl::VertexArrayObj vertex_array(const WireAxes& wa, const WireframeRenderer& wr) {
+gl::VertexArrayObj vertex_array(const WireAxes& wa) {
     auto va = gl::VertexArrayObj();
-    { // Color.
-        auto bindingindex = GLuint(0);
-        gl::VertexArrayAttribFormat(va,
-            wr.color,
-            3, GL_FLOAT,
-            GL_FALSE, 0);
-        gl::VertexArrayVertexBuffer(va,
-            bindingindex,
-            wa.colors,
-            0, sizeof(glm::vec3));
-        gl::VertexArrayAttribBinding(va,
-            wr.color,
-            bindingindex);
-        gl::EnableVertexArrayAttrib(va,
-            wr.color);
-    }
-    { // Position.
-        auto bindingindex = GLuint(1);
-        gl::VertexArrayAttribFormat(va,
-            wr.position,
-            3, GL_FLOAT,
-            GL_FALSE, 0);
-        gl::VertexArrayVertexBuffer(va,
-            bindingindex,
-            wa.positions,
-            0, sizeof(glm::vec3));
-        gl::VertexArrayAttribBinding(va,
-            wr.position,
-            bindingindex);
-        gl::EnableVertexArrayAttrib(va,
-            wr.position);
-    }
+    set_layout(va, wire_axes_layout);
+    // Colors.
+    gl::VertexArrayVertexBuffer(va,
+        0,
+        wa.colors,
+        0, wire_axes_layout.strides[0]);
+    // Positions.
+    gl::VertexArrayVertexBuffer(va,
+        1,
+        wa.positions,
+        0, wire_axes_layout.strides[1]);
     return va;
 }
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/filesystem/recursive_path.hpp"
+#include "common/glsl/program_cache.hpp"
+#include "common/glsl/shader_manager.hpp"
+
+#include <agl/standard/all.hpp>
+
+#include <span>
+#include <string>
+
+namespace glsl {
+
+class GpuCulling {
+public:
+    // 'cull.comp'.
+    gl::ProgramObj cull;
+
+    gl::OptUniformLoc instance_count;
+    gl::OptUniformLoc batch_count;
+    gl::OptUniformLoc frustum_planes;
+    gl::OptUniformLoc use_depth_pyramid;
+    gl::OptUniformLoc depth_pyramid_world_to_clip;
+    gl::OptUniformLoc use_quantization;
+    gl::OptUniformLoc debug_view;
+
+    // 'depth_pyramid.comp'.
+    gl::ProgramObj depth_pyramid;
+
+    gl::OptUniformLoc source_level;
+
+    // Linked and locations resolved, see 'is_ready'.
+    bool is_cull_ready = false;
+    bool is_depth_pyramid_ready = false;
+
+    GpuCulling() {}
+};
+
+inline
+ShaderStage compute_stage(const char* path) {
+    return {GL_COMPUTE_SHADER,
+        agl::standard::string(filesystem::recursive_parent_path(path))};
+}
+
+inline constexpr auto cull_path = "src/common/glsl/gpu_culling/cull.comp";
+inline constexpr auto depth_pyramid_path
+    = "src/common/glsl/gpu_culling/depth_pyramid.comp";
+
+// Once 'cull' is linked.
+inline
+void resolve_cull_interface(GpuCulling& gc) {
+    gc.instance_count = gl::GetUniformLocation(gc.cull,
+        "instance_count");
+    gc.batch_count = gl::GetUniformLocation(gc.cull,
+        "batch_count");
+    gc.frustum_planes = gl::GetUniformLocation(gc.cull,
+        "frustum_planes");
+    gc.use_depth_pyramid = gl::GetUniformLocation(gc.cull,
+        "use_depth_pyramid");
+    gc.depth_pyramid_world_to_clip = gl::GetUniformLocation(gc.cull,
+        "depth_pyramid_world_to_clip");
+    gc.use_quantization = gl::GetUniformLocation(gc.cull,
+        "use_quantization");
+    gc.debug_view = gl::GetUniformLocation(gc.cull,
+        "debug_view");
+    gc.is_cull_ready = true;
+}
+
+// Once 'depth_pyramid' is linked.
+inline
+void resolve_depth_pyramid_interface(GpuCulling& gc) {
+    gc.source_level = gl::GetUniformLocation(gc.depth_pyramid,
+        "source_level");
+    gc.is_depth_pyramid_ready = true;
+}
+
+inline
+bool is_ready(const GpuCulling& gc) {
+    return gc.is_cull_ready and gc.is_depth_pyramid_ready;
+}
+
+// Blocks until linked. The programs are loaded from 'cache' when it holds
+// binaries of the sources.
+inline
+GpuCulling gpu_culling(ProgramCache* cache = nullptr) {
+    auto gc = GpuCulling();
+    { // Cull.
+        auto stage = compute_stage(cull_path);
+        link(gc.cull, std::span(&stage, 1), cache);
+        resolve_cull_interface(gc);
+    }
+    { // Depth pyramid.
+        auto stage = compute_stage(depth_pyramid_path);
+        link(gc.depth_pyramid, std::span(&stage, 1), cache);
+        resolve_depth_pyramid_interface(gc);
+    }
+    return gc;
+}
+
+// Compiles on the driver threads of 'sm', 'gc' is resolved in place once
+// linked, see 'is_ready'.
+inline
+void submit(ShaderManager& sm, GpuCulling& gc) {
+    { // Cull.
+        auto stage = compute_stage(cull_path);
+        submit(sm, gc.cull, std::span(&stage, 1), [&gc]() {
+            resolve_cull_interface(gc);
+        });
+    }
+    { // Depth pyramid.
+        auto stage = compute_stage(depth_pyramid_path);
+        submit(sm, gc.depth_pyramid, std::span(&stage, 1), [&gc]() {
+            resolve_depth_pyramid_interface(gc);
+        });
+    }
+}
+
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/filesystem/mapped_file.hpp"
+#include "common/filesystem/write_file.hpp"
+#include "common/hash/hash.hpp"
+#include "common/time/clock.hpp"
+
+#include <agl/standard/all.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Linked programs saved with 'glGetProgramBinary' and reloaded with
+// 'glProgramBinary'. Each file is named after a hash of the driver and of
+// every stage source, defines included, so a driver update or an edited
+// shader leaves the stale entry unused.
+
+namespace glsl {
+
+// Source of one stage, defines already injected.
+struct ShaderStage {
+    GLenum type;
+    std::string source;
+};
+
+inline constexpr std::uint32_t program_cache_version = 1;
+
+inline constexpr auto program_cache_magic = std::array<char, 8>{
+    'L', 'T', 'P', 'R', 'O', 'G', '\0', '\0'};
+
+// Followed by the binary.
+struct ProgramBinaryHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    GLenum format;
+    std::uint64_t key;
+    std::uint64_t size;
+    // Compiling and linking when written, what a hit saves, see
+    // 'ProgramCache::compile_seconds'.
+    float compile_seconds;
+    std::uint32_t padding;
+};
+
+struct ProgramCache {
+    std::filesystem::path directory;
+    // Of the vendor, renderer and version strings.
+    std::uint64_t driver_hash = 0;
+    // At least one binary format.
+    bool is_supported = false;
+
+    std::size_t hit_count = 0;
+    std::size_t miss_count = 0;
+    // Compiling on misses, and saved by hits. Upper bounds with parallel
+    // compilation, which is only seen done at the next poll.
+    float compile_seconds = 0.f;
+    float saved_seconds = 0.f;
+};
+
+inline
+ProgramCache program_cache(std::filesystem::path directory) {
+    auto pc = ProgramCache();
+    pc.directory = std::move(directory);
+    pc.driver_hash = hash::seed;
+    for(auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        auto s = reinterpret_cast<const char*>(glGetString(name));
+        pc.driver_hash = hash::string((s != nullptr) ? s : "", pc.driver_hash);
+    }
+    auto format_count = GLint(0);
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    pc.is_supported = (format_count > 0);
+    return pc;
+}
+
+inline
+float hit_rate(const ProgramCache& pc) {
+    auto count = pc.hit_count + pc.miss_count;
+    return (count > 0) ? float(pc.hit_count) / float(count) : 0.f;
+}
+
+inline
+std::uint64_t key(const ProgramCache& pc, std::span<const ShaderStage> stages) {
+    auto k = hash::combine(pc.driver_hash, program_cache_version);
+    for(auto& s : stages) {
+        k = hash::combine(k, s.type);
+        k = hash::string(s.source, k);
+    }
+    return k;
+}
+
+inline
+std::filesystem::path path(const ProgramCache& pc, std::uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin",
+        static_cast<unsigned long long>(key));
+    return pc.directory / name;
+}
+
+inline
+bool is_linked(GLuint program) {
+    auto status = GLint(GL_FALSE);
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+inline
+std::string info_log(GLuint program) {
+    auto length = GLint(0);
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    auto log = std::string(std::size_t(std::max(length, 1)), '\0');
+    glGetProgramInfoLog(program, GLsizei(size(log)), nullptr, log.data());
+    log.resize(std::char_traits<char>::length(log.c_str()));
+    return log;
+}
+
+// Queries nothing, so it returns at once with parallel compilation.
+// Attached shaders are only flagged for deletion, they live until linked.
+inline
+void compile(GLuint program, std::span<const ShaderStage> stages) {
+    for(auto& s : stages) {
+        auto shader = gl::Shader(s.type);
+        gl::ShaderSource(shader, s.source);
+        glCompileShader(shader);
+        gl::AttachShader(program, shader);
+    }
+    glLinkProgram(program);
+}
+
+// Links 'program' from the binary of 'key' if 'cache' has one valid for
+// this driver.
+inline
+bool load(ProgramCache& cache, GLuint program, std::uint64_t key) {
+    auto p = path(cache, key);
+    if(not cache.is_supported or not std::filesystem::is_regular_file(p)) {
+        return false;
+    }
+    auto clock = Clock();
+    auto file = filesystem::MappedFile(p);
+    auto bytes = file.bytes();
+    auto h = ProgramBinaryHeader();
+    if(size(bytes) < sizeof(h)) {
+        return false;
+    }
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    if(h.magic != program_cache_magic
+        or h.version != program_cache_version
+        or h.key != key
+        or h.size != size(bytes) - sizeof(h))
+    {
+        return false;
+    }
+    glProgramBinary(program, h.format,
+        bytes.data() + sizeof(h), GLsizei(h.size));
+    // Rejected binaries leave the program unlinked.
+    if(not is_linked(program)) {
+        return false;
+    }
+    cache.hit_count += 1;
+    cache.saved_seconds += std::max(
+        h.compile_seconds - clock.restart().count(), 0.f);
+    return true;
+}
+
+// Must be set before linking a program given to 'store'.
+inline
+void make_retrievable(GLuint program) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// Writes the binary of 'program', linked from sources in 'seconds'.
+inline
+void store(
+    ProgramCache& cache,
+    GLuint program,
+    std::uint64_t key,
+    float seconds)
+{
+    cache.miss_count += 1;
+    cache.compile_seconds += seconds;
+    if(not cache.is_supported or not is_linked(program)) {
+        return;
+    }
+    auto length = GLint(0);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    auto h = ProgramBinaryHeader{
+        .magic = program_cache_magic,
+        .version = program_cache_version,
+        .format = 0,
+        .key = key,
+        .size = 0,
+        .compile_seconds = seconds,
+        .padding = 0,
+    };
+    auto bytes = std::vector<std::byte>(sizeof(h) + std::size_t(length));
+    auto written = GLsizei(0);
+    glGetProgramBinary(program, length, &written, &h.format,
+        bytes.data() + sizeof(h));
+    h.size = std::uint64_t(written);
+    bytes.resize(sizeof(h) + std::size_t(written));
+    std::memcpy(bytes.data(), &h, sizeof(h));
+    try {
+        filesystem::write_file(path(cache, key), bytes);
+    } catch(const std::exception& e) {
+        std::cerr << "Program cache not written: " << e.what() << '\n';
+    }
+}
+
+// Loaded from the binary of 'stages' if 'cache' has a valid one for this
+// driver, compiled and then written to 'cache' otherwise. Blocks until
+// linked, see 'ShaderManager' otherwise. Throws with the info log if
+// compiling or linking failed.
+inline
+void link(
+    gl::ProgramObj& program,
+    std::span<const ShaderStage> stages,
+    ProgramCache* cache = nullptr)
+{
+    if(cache == nullptr) {
+        compile(program, stages);
+    } else {
+        auto k = key(*cache, stages);
+        if(load(*cache, program, k)) {
+            return;
+        }
+        auto clock = Clock();
+        make_retrievable(program);
+        compile(program, stages);
+        store(*cache, program, k, clock.restart().count());
+    }
+    if(not is_linked(program)) {
+        throw std::runtime_error("Program not linked: " + info_log(program));
+    }
+}
+
+}
@@ -2,8 +2,7 @@
 
 uniform mat4 object_to_clip;
 
-in vec3 a_normal;
-in vec3 a_position;
+// Inputs: 'test_inputs' of 'hello_triangle.hpp', declared when compiled.
 
 out vec3 v_color;
 
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+
+#include <span>
+#include <string>
+
+namespace glsl {
+
+// Vertex shader input at an explicit location, as a float scalar or vector.
+// Declared from C++ rather than in the source, so that vertex layouts can be
+// checked against it at compile time, see 'matches'.
+struct ShaderInput {
+    const char* name;
+    GLuint location;
+    GLint count;
+};
+
+inline
+std::string declarations(std::span<const ShaderInput> inputs) {
+    auto lines = std::string();
+    for(auto& i : inputs) {
+        lines += "layout(location = " + std::to_string(i.location) + ") in "
+            + ((i.count == 1) ? std::string("float") : "vec" + std::to_string(i.count))
+            + " " + i.name + ";\n";
+    }
+    return lines;
+}
+
+// Inserts the declarations of 'inputs' after the '#version' and '#extension'
+// directives.
+inline
+std::string with_inputs(
+    std::string source,
+    std::span<const ShaderInput> inputs)
+{
+    auto directive = source.rfind("#extension");
+    if(directive == std::string::npos) {
+        directive = source.find("#version");
+    }
+    auto position = (directive == std::string::npos)
+        ? std::size_t(0)
+        : source.find('\n', directive);
+    if(position == std::string::npos) {
+        source += '\n';
+        position = source.size();
+    } else if(directive != std::string::npos) {
+        position += 1;
+    }
+    source.insert(position, declarations(inputs));
+    return source;
+}
+
+}
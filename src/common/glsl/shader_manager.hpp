@@ -0,0 +1,194 @@
+#pragma once
+
+#include "program_cache.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/dependency/opengl.hpp"
+#include "common/time/clock.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace glsl {
+
+// Submitted, its interface is resolved once linked.
+struct PendingProgram {
+    GLuint program;
+    std::function<void()> on_linked;
+    // Empty when loaded from the cache or without a cache.
+    std::optional<std::uint64_t> key;
+    Clock clock;
+};
+
+// Every program is submitted up front and compiled on driver threads with
+// 'GL_KHR_parallel_shader_compile', then 'poll' resolves the ones whose
+// 'GL_COMPLETION_STATUS_KHR' is set without ever waiting on the driver.
+// Without the extension the first query of a program blocks as usual.
+struct ShaderManager {
+    ProgramCache* cache = nullptr;
+    bool is_parallel = false;
+
+    std::vector<PendingProgram> pending;
+
+    std::size_t submitted_count = 0;
+    std::size_t linked_count = 0;
+    std::size_t failed_count = 0;
+    // From the first submit until nothing is pending.
+    Clock clock;
+    float seconds = 0.f;
+};
+
+inline
+ShaderManager shader_manager(ProgramCache* cache = nullptr) {
+    auto sm = ShaderManager();
+    sm.cache = cache;
+    sm.is_parallel = GLEW_KHR_parallel_shader_compile
+        or GLEW_ARB_parallel_shader_compile;
+    if(GLEW_KHR_parallel_shader_compile) {
+        // As many threads as the driver wants.
+        glMaxShaderCompilerThreadsKHR(0xffffffff);
+    } else if(GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xffffffff);
+    }
+    return sm;
+}
+
+inline
+bool is_pending(const ShaderManager& sm) {
+    return not sm.pending.empty();
+}
+
+inline
+bool is_pending(const ShaderManager& sm, GLuint program) {
+    return std::any_of(begin(sm.pending), end(sm.pending), [&](auto& p) {
+        return p.program == program;
+    });
+}
+
+// Starts compiling 'stages' into 'program' and returns, 'on_linked' is
+// called by 'poll' or 'wait' once linked, so it may resolve locations.
+// 'program' must stay alive until then.
+inline
+void submit(
+    ShaderManager& sm,
+    GLuint program,
+    std::span<const ShaderStage> stages,
+    std::function<void()> on_linked)
+{
+    if(not is_pending(sm)) {
+        sm.clock.restart();
+    }
+    auto& p = sm.pending.emplace_back();
+    p.program = program;
+    p.on_linked = std::move(on_linked);
+    sm.submitted_count += 1;
+    if(sm.cache != nullptr) {
+        auto k = key(*sm.cache, stages);
+        // A binary loads in a fraction of a compile, not worth deferring.
+        if(load(*sm.cache, program, k)) {
+            return;
+        }
+        p.key = k;
+        make_retrievable(program);
+    }
+    p.clock.restart();
+    compile(program, stages);
+}
+
+inline
+bool is_complete(const ShaderManager& sm, GLuint program) {
+    if(not sm.is_parallel) {
+        return true;
+    }
+    auto status = GLint(GL_FALSE);
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &status);
+    return status == GL_TRUE;
+}
+
+// Blocks if still compiling. When resolved by 'poll', the time stored
+// with the binary runs to the poll that saw it done, an upper bound.
+inline
+void resolve(ShaderManager& sm, PendingProgram& p) {
+    if(p.key) {
+        store(*sm.cache, p.program, *p.key, p.clock.restart().count());
+    }
+    if(is_linked(p.program)) {
+        p.on_linked();
+        sm.linked_count += 1;
+    } else {
+        std::cerr << "Program not linked: " << info_log(p.program) << '\n';
+        sm.failed_count += 1;
+    }
+}
+
+inline
+void finish_if_done(ShaderManager& sm) {
+    if(is_pending(sm)) {
+        return;
+    }
+    sm.seconds = sm.clock.restart().count();
+    std::cout << "Programs: " << sm.linked_count << " linked"
+        << ", " << sm.failed_count << " failed"
+        << " in " << 1000.f * sm.seconds << " ms"
+        << (sm.is_parallel ? " (parallel)" : "") << ".\n";
+    if(sm.cache != nullptr) {
+        auto& pc = *sm.cache;
+        std::cout << "Program cache: " << pc.hit_count << " of "
+            << pc.hit_count + pc.miss_count << " hits ("
+            << 100.f * hit_rate(pc) << "%)"
+            << ", " << 1000.f * pc.compile_seconds << " ms compiling"
+            << ", " << 1000.f * pc.saved_seconds << " ms saved"
+            << (sm.is_parallel ? " (upper bounds)" : "")
+            << (pc.is_supported ? "" : ", no binary format") << ".\n";
+    }
+}
+
+// Resolves the programs done compiling. Once per frame.
+inline
+void poll(ShaderManager& sm) {
+    if(not is_pending(sm)) {
+        return;
+    }
+    auto done = std::stable_partition(begin(sm.pending), end(sm.pending),
+        [&](auto& p) { return not is_complete(sm, p.program); });
+    for(auto it = done; it != end(sm.pending); ++it) {
+        resolve(sm, *it);
+    }
+    sm.pending.erase(done, end(sm.pending));
+    finish_if_done(sm);
+}
+
+// Blocks until 'program' is resolved, for the programs needed right away.
+inline
+void wait(ShaderManager& sm, GLuint program) {
+    auto it = std::find_if(begin(sm.pending), end(sm.pending), [&](auto& p) {
+        return p.program == program;
+    });
+    if(it == end(sm.pending)) {
+        return;
+    }
+    auto p = std::move(*it);
+    sm.pending.erase(it);
+    resolve(sm, p);
+    finish_if_done(sm);
+}
+
+// Blocks until every program is resolved.
+inline
+void wait(ShaderManager& sm) {
+    auto pending = std::move(sm.pending);
+    sm.pending.clear();
+    for(auto& p : pending) {
+        resolve(sm, p);
+    }
+    finish_if_done(sm);
+}
+
+}
@@ -1,16 +1,68 @@
 #version 450 core
 
-in vec3 v_texcoords0;
+// Variants, see 'SolidFeature' for the defines and 'minimal' for the
+// combinations that occur.
+
+#ifndef DEPTH_ONLY
+#ifdef HAS_TEXCOORDS0
+in vec2 v_texcoords0;
+#endif
+#ifdef HAS_NORMALS
 in vec3 v_world_normal;
+#endif
+#ifdef FLAT_SHADING
 in vec3 v_world_position;
+#endif
+#ifdef CULLED_TINT
+flat in float v_culled;
+#endif
+
+#ifdef BASE_COLOR_TEXTURE
+flat in uint v_material;
+
+// Layer of a texture array, see 'MaterialData'.
+struct Material {
+    // 'x' is the array, 'y' the layer.
+    uvec4 base_color;
+};
+
+layout(std430, binding = 5) readonly buffer Materials {
+    Material materials[];
+};
+
+// Every resident texture, bound once per frame, see 'TextureArrays'.
+layout(binding = 0) uniform sampler2DArray base_color_arrays[8];
+#endif
 
 out vec4 f_color;
 
+#ifdef FLAT_SHADING
 vec3 flat_normal() {
     return normalize(cross(dFdx(v_world_position), dFdy(v_world_position)));
 }
+#endif
+#endif
 
 void main() {
-    f_color = vec4(v_texcoords0.xy, 0., 1.);
-    // f_color = vec4(flat_normal() * .5 + .5, 1.);
+#ifndef DEPTH_ONLY
+#if defined(NORMAL_VIEW)
+#ifdef FLAT_SHADING
+    vec3 normal = flat_normal();
+#else
+    vec3 normal = normalize(v_world_normal);
+#endif
+    f_color = vec4(normal * .5 + .5, 1.);
+#elif defined(TEXCOORDS_VIEW)
+    f_color = vec4(v_texcoords0, 0., 1.);
+#elif defined(BASE_COLOR_TEXTURE)
+    uvec4 base_color = materials[v_material].base_color;
+    f_color = texture(base_color_arrays[base_color.x],
+        vec3(v_texcoords0, float(base_color.y)));
+#else
+    f_color = vec4(.5, .5, .5, 1.);
+#endif
+#ifdef CULLED_TINT
+    f_color = mix(f_color, vec4(1., 0., 0., 1.), .75 * v_culled);
+#endif
+#endif
 }
@@ -1,21 +1,93 @@
 #version 450 core
+#extension GL_ARB_shader_draw_parameters : require
 
-uniform mat4 object_to_clip;
-uniform mat4 object_to_world_normal;
-uniform mat4 object_to_world_position;
+// Variants, see 'SolidFeature' for the defines and 'minimal' for the
+// combinations that occur.
 
-in vec3 a_normal;
-in vec3 a_position;
-in vec3 a_texcoords0;
+// Camera, written once per frame.
+layout(std140, binding = 0) uniform Frame {
+    mat4 world_to_view;
+    mat4 view_to_clip;
+    mat4 world_to_clip;
+};
 
-out vec3 v_texcoords0;
+// Per object data indexed by base instance, by instance when instanced.
+struct Object {
+    mat4 object_to_world;
+    // Inverse transpose of 'object_to_world'.
+    mat4 object_to_world_normal;
+    // Identity unless positions are quantized.
+    // 'w' is 1 for instances culled on the GPU, see 'gpu_culling/cull.comp'.
+    vec4 position_offset;
+    // 'w' indexes 'materials' of 'shader.frag'.
+    vec4 position_scale;
+};
+
+layout(std430, binding = 0) readonly buffer Objects {
+    Object objects[];
+};
+
+// Inputs are declared above by 'solid_renderer_stages', see 'solid_inputs'
+// and 'compact_solid_inputs'. Locations are fixed so every variant shares
+// the vertex arrays.
+
+#ifndef DEPTH_ONLY
+#ifdef HAS_TEXCOORDS0
+out vec2 v_texcoords0;
+#endif
+#ifdef HAS_NORMALS
 out vec3 v_world_normal;
+#endif
+#ifdef FLAT_SHADING
 out vec3 v_world_position;
+#endif
+#ifdef CULLED_TINT
+flat out float v_culled;
+#endif
+#ifdef BASE_COLOR_TEXTURE
+flat out uint v_material;
+#endif
+#endif
+
+#if defined(COMPACT_VERTEX) && defined(HAS_NORMALS)
+vec3 octahedral_decode(vec2 e) {
+    vec3 n = vec3(e, 1. - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.);
+    n.x += n.x >= 0. ? -t : t;
+    n.y += n.y >= 0. ? -t : t;
+    return normalize(n);
+}
+#endif
 
 void main() {
-    v_texcoords0 = a_texcoords0;
-    v_world_normal = (object_to_world_normal * vec4(a_normal, 0.)).xyz;
-    v_world_position = (object_to_world_position * vec4(a_position, 1.)).xyz;
+    Object object = objects[gl_BaseInstanceARB + gl_InstanceID];
+
+    vec3 position = object.position_offset.xyz
+        + object.position_scale.xyz * a_position;
+    vec4 world_position = object.object_to_world * vec4(position, 1.);
+
+#ifndef DEPTH_ONLY
+#ifdef HAS_TEXCOORDS0
+    v_texcoords0 = a_texcoords0.xy;
+#endif
+#ifdef HAS_NORMALS
+#ifdef COMPACT_VERTEX
+    vec3 normal = octahedral_decode(a_normal);
+#else
+    vec3 normal = a_normal;
+#endif
+    v_world_normal = (object.object_to_world_normal * vec4(normal, 0.)).xyz;
+#endif
+#ifdef FLAT_SHADING
+    v_world_position = world_position.xyz;
+#endif
+#ifdef CULLED_TINT
+    v_culled = object.position_offset.w;
+#endif
+#ifdef BASE_COLOR_TEXTURE
+    v_material = uint(object.position_scale.w);
+#endif
+#endif
 
-    gl_Position = object_to_clip * vec4(a_position, 1.);
+    gl_Position = world_to_clip * world_position;
 }
@@ -2,66 +2,104 @@
 
 #include "common/dependency/abstractgl_api_opengl.hpp"
 #include "common/filesystem/recursive_path.hpp"
+#include "common/glsl/program_cache.hpp"
+#include "common/glsl/shader_input.hpp"
+#include "common/glsl/shader_manager.hpp"
+#include "common/glsl/source.hpp"
 
 #include <agl/standard/all.hpp>
 
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
 namespace glsl {
 
+// Of 'shader.vert', three floats per attribute.
+inline constexpr auto solid_inputs = std::array<ShaderInput, 3>{{
+    {"a_normal", 0, 3},
+    {"a_position", 1, 3},
+    {"a_texcoords0", 2, 3},
+}};
+
+// With 'COMPACT_VERTEX', octahedral normals and two texcoords.
+inline constexpr auto compact_solid_inputs = std::array<ShaderInput, 3>{{
+    {"a_normal", 0, 2},
+    {"a_position", 1, 3},
+    {"a_texcoords0", 2, 2},
+}};
+
 class SolidRenderer {
 public:
     gl::ProgramObj program;
 
-    gl::OptAttribLoc normal;
-    gl::OptAttribLoc position;
-    gl::OptAttribLoc texcoords0;
+    // Inputs: 'solid_inputs' or 'compact_solid_inputs', shared by every
+    // variant whether it reads them or not.
+
+    // Blocks: 'Frame' at uniform buffer binding 0, 'Objects' at storage
+    // buffer binding 0, indexed by base instance, 'Materials' at storage
+    // buffer binding 5 with 'BASE_COLOR_TEXTURE'.
 
-    gl::OptUniformLoc object_to_clip;
-    gl::OptUniformLoc object_to_world_normal;
-    gl::OptUniformLoc object_to_world_position;
+    // Linked.
+    bool is_ready = false;
 
     SolidRenderer() {}
 };
 
+// 'defines' are injected in both stages, see 'SolidFeature' for the options.
+inline
+std::array<ShaderStage, 2> solid_renderer_stages(
+    const std::vector<std::string>& defines)
+{
+    auto compact = std::find(begin(defines), end(defines), "COMPACT_VERTEX")
+        != end(defines);
+    return {
+        ShaderStage{GL_VERTEX_SHADER,
+            with_inputs(with_defines(agl::standard::string(
+                filesystem::recursive_parent_path(
+                    "src/common/glsl/solid_renderer/shader.vert")),
+                defines),
+                compact ? std::span<const ShaderInput>(compact_solid_inputs)
+                    : std::span<const ShaderInput>(solid_inputs))},
+        ShaderStage{GL_FRAGMENT_SHADER,
+            with_defines(agl::standard::string(
+                filesystem::recursive_parent_path(
+                    "src/common/glsl/solid_renderer/shader.frag")),
+                defines)},
+    };
+}
+
+// Once linked.
 inline
-SolidRenderer solid_renderer() {
+void resolve_interface(SolidRenderer& sr) {
+    sr.is_ready = true;
+}
+
+// Blocks until linked. The program is loaded from 'cache' when it holds a
+// binary of these sources.
+inline
+SolidRenderer solid_renderer(
+    const std::vector<std::string>& defines = {},
+    ProgramCache* cache = nullptr)
+{
     auto sr = SolidRenderer();
-    { // Program.
-        { // Compiling and linking.
-            auto vertex_shader = gl::VertexShaderObj();
-            gl::ShaderSource(vertex_shader,
-                agl::standard::string(
-                    filesystem::recursive_parent_path(
-                        "src/common/glsl/solid_renderer/shader.vert")));
-            glCompileShader(vertex_shader);
-
-            auto fragment_shader = gl::Shader(gl::FRAGMENT_SHADER);
-            gl::ShaderSource(fragment_shader,
-                agl::standard::string(
-                    filesystem::recursive_parent_path(
-                        "src/common/glsl/solid_renderer/shader.frag")));
-            glCompileShader(fragment_shader);
-
-            gl::AttachShader(sr.program, vertex_shader);
-            gl::AttachShader(sr.program, fragment_shader);
-            gl::LinkProgram(sr.program);
-        }
-        { // Interface.
-            sr.normal = gl::GetAttribLocation(sr.program,
-                "a_normal");
-            sr.position = gl::GetAttribLocation(sr.program,
-                "a_position");
-            sr.texcoords0 = gl::GetAttribLocation(sr.program,
-                "a_texcoords0");
-
-            sr.object_to_clip = gl::GetUniformLocation(sr.program,
-                "object_to_clip");
-            sr.object_to_world_normal = gl::GetUniformLocation(sr.program,
-                "object_to_world_normal");
-            sr.object_to_world_position = gl::GetUniformLocation(sr.program,
-                "object_to_world_position");
-        }
-    }
+    link(sr.program, solid_renderer_stages(defines), cache);
+    resolve_interface(sr);
     return sr;
 }
 
+// Compiles on the driver threads of 'sm', 'sr' is resolved in place once
+// linked, see 'SolidRenderer::is_ready'.
+inline
+void submit(
+    ShaderManager& sm,
+    SolidRenderer& sr,
+    const std::vector<std::string>& defines = {})
+{
+    submit(sm, sr.program, solid_renderer_stages(defines), [&sr]() {
+        resolve_interface(sr);
+    });
+}
+
 }
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "solid_renderer.hpp"
+
+#include "common/glsl/program_cache.hpp"
+#include "common/glsl/shader_manager.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace glsl {
+
+// Bits of 'SolidFeatures', each one a '#define' of 'shader.vert' and
+// 'shader.frag'.
+enum class SolidFeature : std::uint32_t {
+    // 'VertexFormat::interleaved' or 'VertexFormat::quantized' attributes.
+    compact_vertex,
+    has_normals,
+    has_texcoords0,
+    // Samples the material base color from the texture arrays.
+    base_color_texture,
+    // World normals as colors.
+    normal_view,
+    texcoords_view,
+    // Normals from screen space derivatives of the position.
+    flat_shading,
+    // Tints the instances culled on the GPU.
+    culled_tint,
+    // Positions only, no color output.
+    depth_only,
+};
+
+inline constexpr std::size_t solid_feature_count = 9;
+
+inline constexpr const char* solid_feature_defines[solid_feature_count] = {
+    "COMPACT_VERTEX",
+    "HAS_NORMALS",
+    "HAS_TEXCOORDS0",
+    "BASE_COLOR_TEXTURE",
+    "NORMAL_VIEW",
+    "TEXCOORDS_VIEW",
+    "FLAT_SHADING",
+    "CULLED_TINT",
+    "DEPTH_ONLY",
+};
+
+using SolidFeatures = std::uint32_t;
+
+inline
+constexpr SolidFeatures bit(SolidFeature f) noexcept {
+    return SolidFeatures(1) << std::uint32_t(f);
+}
+
+inline
+constexpr bool has(SolidFeatures fs, SolidFeature f) noexcept {
+    return (fs & bit(f)) != 0;
+}
+
+// Keeps only what the shading of 'fs' reads, so that equivalent requests
+// share a program and no variant carries an unused attribute:
+// - 'depth_only' keeps the vertex format alone,
+// - 'normal_view' reads vertex normals, or derivatives without them or
+//   with 'flat_shading',
+// - otherwise texcoords are read by 'texcoords_view' or
+//   'base_color_texture', and dropped with both when absent.
+inline
+constexpr SolidFeatures minimal(SolidFeatures fs) noexcept {
+    using enum SolidFeature;
+    if(has(fs, depth_only)) {
+        return fs & (bit(compact_vertex) | bit(depth_only));
+    }
+    auto m = fs & (bit(compact_vertex) | bit(culled_tint));
+    if(has(fs, normal_view)) {
+        m |= bit(normal_view);
+        m |= (has(fs, has_normals) and not has(fs, flat_shading))
+            ? bit(has_normals)
+            : bit(flat_shading);
+    } else if(has(fs, has_texcoords0)) {
+        if(has(fs, texcoords_view)) {
+            m |= bit(texcoords_view) | bit(has_texcoords0);
+        } else if(has(fs, base_color_texture)) {
+            m |= bit(base_color_texture) | bit(has_texcoords0);
+        }
+    }
+    return m;
+}
+
+static_assert(minimal(bit(SolidFeature::depth_only)
+    | bit(SolidFeature::has_normals)) == bit(SolidFeature::depth_only));
+static_assert(minimal(bit(SolidFeature::normal_view))
+    == (bit(SolidFeature::normal_view) | bit(SolidFeature::flat_shading)));
+static_assert(minimal(bit(SolidFeature::base_color_texture)) == 0);
+// Texcoords without a texture, the untextured variant.
+static_assert(minimal(bit(SolidFeature::has_texcoords0)
+    | bit(SolidFeature::has_normals)) == 0);
+static_assert(minimal(bit(SolidFeature::has_texcoords0)
+    | bit(SolidFeature::base_color_texture))
+    == (bit(SolidFeature::has_texcoords0) | bit(SolidFeature::base_color_texture)));
+
+// Upper bound on the variants of 'SolidVariants', the distinct minimal
+// feature sets.
+inline constexpr std::size_t solid_variant_count = []() {
+    auto is_minimal = std::array<bool, std::size_t(1) << solid_feature_count>();
+    for(std::size_t fs = 0; fs < size(is_minimal); ++fs) {
+        is_minimal[minimal(SolidFeatures(fs))] = true;
+    }
+    return std::size_t(std::count(begin(is_minimal), end(is_minimal), true));
+}();
+
+// Variant indices fit in this many bits, render keys store them. Raise it
+// when a new 'SolidFeature' makes this fail, rather than fail at draw time.
+inline constexpr int solid_variant_index_bits = 6;
+
+static_assert(solid_variant_count <= std::size_t(1) << solid_variant_index_bits);
+
+inline
+std::vector<std::string> defines(SolidFeatures fs) {
+    auto ds = std::vector<std::string>();
+    for(std::size_t f = 0; f < solid_feature_count; ++f) {
+        if(has(fs, SolidFeature(f))) {
+            ds.push_back(solid_feature_defines[f]);
+        }
+    }
+    return ds;
+}
+
+// Programs of the solid renderer sources, one per minimal feature set,
+// submitted on first use or ahead of time with 'prewarm'.
+struct SolidVariants {
+    // Minimal, in submission order.
+    std::vector<SolidFeatures> features;
+    // Filled in place by the shader manager, so they must not move.
+    std::vector<std::unique_ptr<SolidRenderer>> renderers;
+};
+
+// Index of the variant of 'fs' in 'sv', submitted to 'sm' if new.
+inline
+std::size_t variant_index(
+    SolidVariants& sv,
+    ShaderManager& sm,
+    SolidFeatures fs)
+{
+    fs = minimal(fs);
+    auto it = std::find(begin(sv.features), end(sv.features), fs);
+    if(it != end(sv.features)) {
+        return std::size_t(it - begin(sv.features));
+    }
+    sv.features.push_back(fs);
+    auto& sr = *sv.renderers.emplace_back(std::make_unique<SolidRenderer>());
+    submit(sm, sr, defines(fs));
+    return size(sv.features) - 1;
+}
+
+// Not drawable before 'SolidRenderer::is_ready'.
+inline
+SolidRenderer& variant(SolidVariants& sv, ShaderManager& sm, SolidFeatures fs) {
+    return *sv.renderers[variant_index(sv, sm, fs)];
+}
+
+// Submits all of them at once, so the driver compiles them in parallel.
+inline
+void prewarm(
+    SolidVariants& sv,
+    ShaderManager& sm,
+    std::span<const SolidFeatures> features)
+{
+    for(auto fs : features) {
+        variant_index(sv, sm, fs);
+    }
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace glsl {
+
+// Inserts a '#define' line for each of 'defines' after the '#version' directive.
+inline
+std::string with_defines(
+    std::string source,
+    const std::vector<std::string>& defines)
+{
+    if(defines.empty()) {
+        return source;
+    }
+    auto lines = std::string();
+    for(auto& d : defines) {
+        lines += "#define " + d + "\n";
+    }
+    auto version = source.find("#version");
+    auto position = (version == std::string::npos)
+        ? std::size_t(0)
+        : source.find('\n', version);
+    if(position == std::string::npos) {
+        source += '\n';
+        position = source.size();
+    } else if(version != std::string::npos) {
+        position += 1;
+    }
+    source.insert(position, lines);
+    return source;
+}
+
+}
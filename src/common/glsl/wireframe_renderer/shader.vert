@@ -2,8 +2,7 @@
 
 uniform mat4 object_to_clip;
 
-in vec3 a_color;
-in vec3 a_position;
+// Inputs are declared above, see 'wireframe_inputs'.
 
 out vec3 v_color;
 
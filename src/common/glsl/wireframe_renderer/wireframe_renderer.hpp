@@ -1,52 +1,70 @@
 #pragma once
 
 #include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/filesystem/recursive_path.hpp"
+#include "common/glsl/program_cache.hpp"
+#include "common/glsl/shader_input.hpp"
+#include "common/glsl/shader_manager.hpp"
 
 #include <agl/standard/all.hpp>
 
+#include <array>
+
+// Of 'shader.vert'.
+inline constexpr auto wireframe_inputs = std::array<glsl::ShaderInput, 2>{{
+    {"a_color", 0, 3},
+    {"a_position", 1, 3},
+}};
+
 struct WireframeRenderer {
     gl::ProgramObj program;
 
-    // Attribute locations.
-
-    gl::AttribLoc color = 0;
-    gl::AttribLoc position = 0;
+    // Inputs: 'wireframe_inputs'.
 
     // Uniform locations.
 
     gl::OptUniformLoc object_to_clip;
+
+    // Linked and locations resolved.
+    bool is_ready = false;
 };
 
 inline
-WireframeRenderer wireframe_renderer() {
+std::array<glsl::ShaderStage, 2> wireframe_renderer_stages() {
+    return {
+        glsl::ShaderStage{GL_VERTEX_SHADER,
+            glsl::with_inputs(agl::standard::string(filesystem::recursive_parent_path(
+                "src/common/glsl/wireframe_renderer/shader.vert")),
+                wireframe_inputs)},
+        glsl::ShaderStage{GL_FRAGMENT_SHADER,
+            agl::standard::string(filesystem::recursive_parent_path(
+                "src/common/glsl/wireframe_renderer/shader.frag"))},
+    };
+}
+
+// Once linked.
+inline
+void resolve_interface(WireframeRenderer& wr) {
+    wr.object_to_clip = gl::GetUniformLocation(wr.program,
+        "object_to_clip");
+    wr.is_ready = true;
+}
+
+// Blocks until linked. The program is loaded from 'cache' when it holds a
+// binary of the sources.
+inline
+WireframeRenderer wireframe_renderer(glsl::ProgramCache* cache = nullptr) {
     auto wr = WireframeRenderer();
-    { // Program.
-        { // Compiling and linking.
-            auto vertex_shader = gl::VertexShaderObj();
-            gl::ShaderSource(vertex_shader,
-                agl::standard::string(
-                    "D:/dev/project/abstractgl-sandbox/src/common/glsl/wireframe_renderer/shader.vert"));
-            glCompileShader(vertex_shader);
-
-            auto fragment_shader = gl::Shader(gl::FRAGMENT_SHADER);
-            gl::ShaderSource(fragment_shader,
-                agl::standard::string(
-                    "D:/dev/project/abstractgl-sandbox/src/common/glsl/wireframe_renderer/shader.frag"));
-            glCompileShader(fragment_shader);
-
-            gl::AttachShader(wr.program, vertex_shader);
-            gl::AttachShader(wr.program, fragment_shader);
-            gl::LinkProgram(wr.program);
-        }
-        { // Interface.
-            wr.color = gl::GetAttribLocation(wr.program,
-                "a_color");
-            wr.position = gl::GetAttribLocation(wr.program,
-                "a_position");
-
-            wr.object_to_clip = gl::GetUniformLocation(wr.program,
-                "object_to_clip");
-        }
-    }
+    glsl::link(wr.program, wireframe_renderer_stages(), cache);
+    resolve_interface(wr);
     return wr;
 }
+
+// Compiles on the driver threads of 'sm', 'wr' is resolved in place once
+// linked, see 'WireframeRenderer::is_ready'.
+inline
+void submit(glsl::ShaderManager& sm, WireframeRenderer& wr) {
+    glsl::submit(sm, wr.program, wireframe_renderer_stages(), [&wr]() {
+        resolve_interface(wr);
+    });
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+namespace hash {
+
+inline constexpr std::uint64_t seed = 0x9e3779b97f4a7c15ull;
+
+// Finalizer from MurmurHash3.
+inline
+constexpr std::uint64_t mix(std::uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+inline
+constexpr std::uint64_t combine(std::uint64_t h, std::uint64_t value) noexcept {
+    return mix(h ^ (value + seed + (h << 6) + (h >> 2)));
+}
+
+// Not cryptographic, only meant to detect stale caches.
+// Consumes 32 bytes per iteration over four independent lanes.
+inline
+std::uint64_t bytes(std::span<const std::byte> data, std::uint64_t h = seed) noexcept {
+    constexpr auto prime = 0x100000001b3ull;
+    std::uint64_t lanes[4] = {h, h ^ 1, h ^ 2, h ^ 3};
+    auto read = [](const std::byte* p) {
+        auto word = std::uint64_t();
+        std::memcpy(&word, p, sizeof(word));
+        return word;
+    };
+    auto p = data.data();
+    auto remaining = data.size();
+    for(; remaining >= 32; p += 32, remaining -= 32) {
+        for(int i = 0; i < 4; ++i) {
+            lanes[i] = (lanes[i] ^ mix(read(p + 8 * i))) * prime;
+        }
+    }
+    for(; remaining >= 8; p += 8, remaining -= 8) {
+        lanes[0] = (lanes[0] ^ mix(read(p))) * prime;
+    }
+    auto tail = std::uint64_t();
+    std::memcpy(&tail, p, remaining);
+    lanes[1] = (lanes[1] ^ mix(tail)) * prime;
+    auto result = combine(lanes[0], lanes[1]);
+    result = combine(result, lanes[2]);
+    result = combine(result, lanes[3]);
+    return combine(result, data.size());
+}
+
+inline
+std::uint64_t string(std::string_view s, std::uint64_t h = seed) noexcept {
+    return bytes(std::as_bytes(std::span(s.data(), s.size())), h);
+}
+
+}
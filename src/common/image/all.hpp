@@ -0,0 +1,6 @@
+#pragma once
+
+#include "block_compression.hpp"
+#include "decode.hpp"
+#include "image.hpp"
+#include "mip_chain.hpp"
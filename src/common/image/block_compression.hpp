@@ -0,0 +1,607 @@
+#pragma once
+
+#include "image.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// BC1, BC3 and BC7 block compression of 4x4 texel blocks.
+// Endpoints are the extremes of the texels projected on their principal
+// axis, BC1 endpoints are then refit by least squares. BC7 only uses mode 6,
+// a single RGBA subset with 4 bit indices.
+namespace image {
+
+enum class BlockFormat : std::uint32_t {
+    // RGB, 4 bits per texel.
+    bc1,
+    // BC1 color and BC4 alpha, 8 bits per texel.
+    bc3,
+    // RGBA, 8 bits per texel.
+    bc7,
+};
+
+inline constexpr std::size_t block_format_count = 3;
+
+inline constexpr const char* block_format_names[block_format_count] = {
+    "BC1",
+    "BC3",
+    "BC7",
+};
+
+inline constexpr
+std::size_t block_bytes(BlockFormat f) noexcept {
+    return (f == BlockFormat::bc1) ? 8 : 16;
+}
+
+// Blocks in row major order, partial blocks at the right and bottom edges.
+struct BlockImage {
+    BlockFormat format = BlockFormat::bc1;
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> blocks;
+};
+
+inline constexpr
+int block_count(int texels) noexcept {
+    return (texels + 3) / 4;
+}
+
+inline
+BlockImage block_image(int width, int height, BlockFormat format) {
+    auto bi = BlockImage();
+    bi.format = format;
+    bi.width = width;
+    bi.height = height;
+    bi.blocks.resize(std::size_t(block_count(width)) * std::size_t(block_count(height))
+        * block_bytes(format));
+    return bi;
+}
+
+inline
+std::size_t block_row_bytes(const BlockImage& bi) noexcept {
+    return std::size_t(block_count(bi.width)) * block_bytes(bi.format);
+}
+
+namespace bc {
+
+// RGBA of the 16 texels of a block, row major.
+using Texels = std::array<std::array<std::uint8_t, 4>, 16>;
+
+// Clamped to the edges of 'i'.
+inline
+Texels fetch(const Rgba8& i, int bx, int by) {
+    auto t = Texels();
+    for(int y = 0; y < 4; ++y) {
+        auto sy = std::min(4 * by + y, i.height - 1);
+        for(int x = 0; x < 4; ++x) {
+            auto sx = std::min(4 * bx + x, i.width - 1);
+            auto p = i.pixels.data() + 4 * (std::size_t(sy) * std::size_t(i.width) + std::size_t(sx));
+            t[4 * y + x] = {p[0], p[1], p[2], p[3]};
+        }
+    }
+    return t;
+}
+
+// Mean and dominant direction of the first 'N' channels of the texels,
+// by power iteration on their covariance.
+template<int N>
+std::pair<std::array<float, N>, std::array<float, N>>
+principal_axis(const Texels& t) {
+    auto mean = std::array<float, N>();
+    for(auto& texel : t) {
+        for(int c = 0; c < N; ++c) {
+            mean[c] += float(texel[c]) / 16.f;
+        }
+    }
+    auto covariance = std::array<std::array<float, N>, N>();
+    for(auto& texel : t) {
+        for(int i = 0; i < N; ++i) {
+            for(int j = 0; j < N; ++j) {
+                covariance[i][j] += (float(texel[i]) - mean[i]) * (float(texel[j]) - mean[j]);
+            }
+        }
+    }
+    auto axis = std::array<float, N>();
+    axis.fill(1.f);
+    for(int iteration = 0; iteration < 8; ++iteration) {
+        auto next = std::array<float, N>();
+        for(int i = 0; i < N; ++i) {
+            for(int j = 0; j < N; ++j) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+        }
+        auto length = 0.f;
+        for(auto v : next) {
+            length = std::max(length, std::abs(v));
+        }
+        if(length == 0.f) {
+            // Constant block, any direction works.
+            break;
+        }
+        for(int i = 0; i < N; ++i) {
+            axis[i] = next[i] / length;
+        }
+    }
+    return {mean, axis};
+}
+
+// Extremes of the texels projected on their principal axis.
+template<int N>
+std::pair<std::array<float, N>, std::array<float, N>>
+principal_endpoints(const Texels& t) {
+    auto [mean, axis] = principal_axis<N>(t);
+    auto lo = 0.f;
+    auto hi = 0.f;
+    for(auto& texel : t) {
+        auto d = 0.f;
+        for(int c = 0; c < N; ++c) {
+            d += (float(texel[c]) - mean[c]) * axis[c];
+        }
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+    }
+    auto norm = 0.f;
+    for(auto v : axis) {
+        norm += v * v;
+    }
+    auto e0 = mean;
+    auto e1 = mean;
+    if(norm > 0.f) {
+        for(int c = 0; c < N; ++c) {
+            e0[c] += axis[c] * lo / norm;
+            e1[c] += axis[c] * hi / norm;
+        }
+    }
+    return {e0, e1};
+}
+
+//
+// BC1.
+//
+
+inline
+std::uint16_t rgb565(const std::array<float, 3>& c) {
+    auto r = std::clamp(std::lround(c[0] * 31.f / 255.f), 0l, 31l);
+    auto g = std::clamp(std::lround(c[1] * 63.f / 255.f), 0l, 63l);
+    auto b = std::clamp(std::lround(c[2] * 31.f / 255.f), 0l, 31l);
+    return std::uint16_t((r << 11) | (g << 5) | b);
+}
+
+inline
+std::array<int, 3> rgb888(std::uint16_t c) {
+    auto r = (c >> 11) & 31;
+    auto g = (c >> 5) & 63;
+    auto b = c & 31;
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+// Four color mode when 'c0 > c1'.
+inline
+std::array<std::array<int, 3>, 4> bc1_palette(std::uint16_t c0, std::uint16_t c1) {
+    auto p = std::array<std::array<int, 3>, 4>();
+    p[0] = rgb888(c0);
+    p[1] = rgb888(c1);
+    for(int c = 0; c < 3; ++c) {
+        if(c0 > c1) {
+            p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+            p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+        } else {
+            p[2][c] = (p[0][c] + p[1][c]) / 2;
+            p[3][c] = 0;
+        }
+    }
+    return p;
+}
+
+// Returns the squared error.
+inline
+int bc1_indices(
+    const Texels& t,
+    std::uint16_t c0,
+    std::uint16_t c1,
+    std::array<int, 16>& indices)
+{
+    auto p = bc1_palette(c0, c1);
+    auto error = 0;
+    for(int i = 0; i < 16; ++i) {
+        auto best = 0;
+        auto best_d = std::numeric_limits<int>::max();
+        for(int pi = 0; pi < 4; ++pi) {
+            auto d = 0;
+            for(int c = 0; c < 3; ++c) {
+                auto e = int(t[i][c]) - p[pi][c];
+                d += e * e;
+            }
+            if(d < best_d) {
+                best = pi;
+                best_d = d;
+            }
+        }
+        indices[i] = best;
+        error += best_d;
+    }
+    return error;
+}
+
+// Least squares endpoints of 'indices' in four color mode.
+inline
+bool bc1_refit(
+    const Texels& t,
+    const std::array<int, 16>& indices,
+    std::array<float, 3>& e0,
+    std::array<float, 3>& e1)
+{
+    constexpr float weights[4] = {1.f, 0.f, 2.f / 3.f, 1.f / 3.f};
+    auto aa = 0.f;
+    auto ab = 0.f;
+    auto bb = 0.f;
+    auto ax = std::array<float, 3>();
+    auto bx = std::array<float, 3>();
+    for(int i = 0; i < 16; ++i) {
+        auto a = weights[indices[i]];
+        auto b = 1.f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for(int c = 0; c < 3; ++c) {
+            ax[c] += a * float(t[i][c]);
+            bx[c] += b * float(t[i][c]);
+        }
+    }
+    auto det = aa * bb - ab * ab;
+    if(std::abs(det) < 1e-6f) {
+        return false;
+    }
+    for(int c = 0; c < 3; ++c) {
+        e0[c] = (bb * ax[c] - ab * bx[c]) / det;
+        e1[c] = (aa * bx[c] - ab * ax[c]) / det;
+    }
+    return true;
+}
+
+inline
+void encode_bc1(const Texels& t, std::uint8_t* out) {
+    auto [e0, e1] = principal_endpoints<3>(t);
+    auto c0 = rgb565(e1);
+    auto c1 = rgb565(e0);
+    if(c0 < c1) {
+        std::swap(c0, c1);
+    }
+    auto indices = std::array<int, 16>();
+    auto error = bc1_indices(t, c0, c1, indices);
+    if(c0 != c1 and bc1_refit(t, indices, e0, e1)) {
+        auto r0 = rgb565(e0);
+        auto r1 = rgb565(e1);
+        if(r0 < r1) {
+            std::swap(r0, r1);
+        }
+        auto refit_indices = std::array<int, 16>();
+        if(r0 != r1) {
+            auto refit_error = bc1_indices(t, r0, r1, refit_indices);
+            if(refit_error < error) {
+                c0 = r0;
+                c1 = r1;
+                indices = refit_indices;
+            }
+        }
+    }
+    if(c0 == c1) {
+        // Three color mode, index 0 is still 'c0'.
+        indices.fill(0);
+    }
+    auto bits = std::uint32_t(0);
+    for(int i = 0; i < 16; ++i) {
+        bits |= std::uint32_t(indices[i]) << (2 * i);
+    }
+    out[0] = std::uint8_t(c0);
+    out[1] = std::uint8_t(c0 >> 8);
+    out[2] = std::uint8_t(c1);
+    out[3] = std::uint8_t(c1 >> 8);
+    for(int b = 0; b < 4; ++b) {
+        out[4 + b] = std::uint8_t(bits >> (8 * b));
+    }
+}
+
+// Leaves alpha untouched unless three color mode makes a texel transparent.
+inline
+void decode_bc1(const std::uint8_t* in, Texels& t) {
+    auto c0 = std::uint16_t(in[0] | (in[1] << 8));
+    auto c1 = std::uint16_t(in[2] | (in[3] << 8));
+    auto p = bc1_palette(c0, c1);
+    for(int i = 0; i < 16; ++i) {
+        auto index = (in[4 + i / 4] >> (2 * (i % 4))) & 3;
+        for(int c = 0; c < 3; ++c) {
+            t[i][c] = std::uint8_t(p[index][c]);
+        }
+        if(c0 <= c1 and index == 3) {
+            t[i][3] = 0;
+        }
+    }
+}
+
+//
+// BC4, one channel.
+//
+
+// Eight value mode when 'a0 > a1'.
+inline
+std::array<int, 8> bc4_palette(int a0, int a1) {
+    auto p = std::array<int, 8>();
+    p[0] = a0;
+    p[1] = a1;
+    if(a0 > a1) {
+        for(int i = 1; i < 7; ++i) {
+            p[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+    } else {
+        for(int i = 1; i < 5; ++i) {
+            p[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        }
+        p[6] = 0;
+        p[7] = 255;
+    }
+    return p;
+}
+
+inline
+void encode_bc4(const Texels& t, int channel, std::uint8_t* out) {
+    auto a0 = 0;
+    auto a1 = 255;
+    for(auto& texel : t) {
+        a0 = std::max(a0, int(texel[channel]));
+        a1 = std::min(a1, int(texel[channel]));
+    }
+    auto p = bc4_palette(a0, a1);
+    auto bits = std::uint64_t(0);
+    for(int i = 0; i < 16; ++i) {
+        auto best = 0;
+        auto best_d = 256;
+        for(int pi = 0; pi < ((a0 > a1) ? 8 : 1); ++pi) {
+            auto d = std::abs(int(t[i][channel]) - p[pi]);
+            if(d < best_d) {
+                best = pi;
+                best_d = d;
+            }
+        }
+        bits |= std::uint64_t(best) << (3 * i);
+    }
+    out[0] = std::uint8_t(a0);
+    out[1] = std::uint8_t(a1);
+    for(int b = 0; b < 6; ++b) {
+        out[2 + b] = std::uint8_t(bits >> (8 * b));
+    }
+}
+
+inline
+void decode_bc4(const std::uint8_t* in, int channel, Texels& t) {
+    auto p = bc4_palette(in[0], in[1]);
+    auto bits = std::uint64_t(0);
+    for(int b = 0; b < 6; ++b) {
+        bits |= std::uint64_t(in[2 + b]) << (8 * b);
+    }
+    for(int i = 0; i < 16; ++i) {
+        t[i][channel] = std::uint8_t(p[(bits >> (3 * i)) & 7]);
+    }
+}
+
+//
+// BC7 mode 6.
+//
+
+inline constexpr int bc7_weights4[16] = {
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Little endian bit stream of a 128 bit block.
+struct Bits128 {
+    std::uint8_t* bytes;
+    int position = 0;
+
+    void write(std::uint32_t value, int count) {
+        for(int i = 0; i < count; ++i, ++position) {
+            if((value >> i) & 1) {
+                bytes[position / 8] |= std::uint8_t(1 << (position % 8));
+            }
+        }
+    }
+
+    std::uint32_t read(int count) {
+        auto value = std::uint32_t(0);
+        for(int i = 0; i < count; ++i, ++position) {
+            value |= std::uint32_t((bytes[position / 8] >> (position % 8)) & 1) << i;
+        }
+        return value;
+    }
+};
+
+// 7 bits per channel and a shared low bit, picks the low bit of least error.
+inline
+std::pair<std::array<int, 4>, int> bc7_quantize(const std::array<float, 4>& e) {
+    auto best = std::array<int, 4>();
+    auto best_p = 0;
+    auto best_error = std::numeric_limits<float>::max();
+    for(int p = 0; p < 2; ++p) {
+        auto q = std::array<int, 4>();
+        auto error = 0.f;
+        for(int c = 0; c < 4; ++c) {
+            q[c] = int(std::clamp(std::lround((e[c] - float(p)) / 2.f), 0l, 127l));
+            auto d = float((q[c] << 1) | p) - e[c];
+            error += d * d;
+        }
+        if(error < best_error) {
+            best = q;
+            best_p = p;
+            best_error = error;
+        }
+    }
+    return {best, best_p};
+}
+
+inline
+void encode_bc7(const Texels& t, std::uint8_t* out) {
+    auto [e0, e1] = principal_endpoints<4>(t);
+    auto [q0, p0] = bc7_quantize(e0);
+    auto [q1, p1] = bc7_quantize(e1);
+    auto u0 = std::array<int, 4>();
+    auto u1 = std::array<int, 4>();
+    for(int c = 0; c < 4; ++c) {
+        u0[c] = (q0[c] << 1) | p0;
+        u1[c] = (q1[c] << 1) | p1;
+    }
+    auto indices = std::array<int, 16>();
+    for(int i = 0; i < 16; ++i) {
+        auto best_d = std::numeric_limits<int>::max();
+        for(int wi = 0; wi < 16; ++wi) {
+            auto w = bc7_weights4[wi];
+            auto d = 0;
+            for(int c = 0; c < 4; ++c) {
+                auto v = ((64 - w) * u0[c] + w * u1[c] + 32) >> 6;
+                auto e = int(t[i][c]) - v;
+                d += e * e;
+            }
+            if(d < best_d) {
+                indices[i] = wi;
+                best_d = d;
+            }
+        }
+    }
+    // The most significant bit of the first index is implicitly zero.
+    if(indices[0] >= 8) {
+        std::swap(q0, q1);
+        std::swap(p0, p1);
+        for(auto& index : indices) {
+            index = 15 - index;
+        }
+    }
+    std::fill(out, out + 16, std::uint8_t(0));
+    auto bits = Bits128{out};
+    bits.write(1 << 6, 7);
+    for(int c = 0; c < 4; ++c) {
+        bits.write(std::uint32_t(q0[c]), 7);
+        bits.write(std::uint32_t(q1[c]), 7);
+    }
+    bits.write(std::uint32_t(p0), 1);
+    bits.write(std::uint32_t(p1), 1);
+    for(int i = 0; i < 16; ++i) {
+        bits.write(std::uint32_t(indices[i]), (i == 0) ? 3 : 4);
+    }
+}
+
+// Mode 6 only, other modes decode to black.
+inline
+void decode_bc7(const std::uint8_t* in, Texels& t) {
+    auto block = std::array<std::uint8_t, 16>();
+    std::copy(in, in + 16, begin(block));
+    auto bits = Bits128{block.data()};
+    if(bits.read(7) != (1 << 6)) {
+        for(auto& texel : t) {
+            texel = {0, 0, 0, 0};
+        }
+        return;
+    }
+    auto u0 = std::array<int, 4>();
+    auto u1 = std::array<int, 4>();
+    for(int c = 0; c < 4; ++c) {
+        u0[c] = int(bits.read(7)) << 1;
+        u1[c] = int(bits.read(7)) << 1;
+    }
+    auto p0 = int(bits.read(1));
+    auto p1 = int(bits.read(1));
+    for(int i = 0; i < 16; ++i) {
+        auto w = bc7_weights4[bits.read((i == 0) ? 3 : 4)];
+        for(int c = 0; c < 4; ++c) {
+            t[i][c] = std::uint8_t(((64 - w) * (u0[c] | p0) + w * (u1[c] | p1) + 32) >> 6);
+        }
+    }
+}
+
+}
+
+// Block rows [first, last) of 'out' from 'source' of the same size.
+inline
+void compress_rows(const Rgba8& source, BlockImage& out, int first, int last) {
+    auto bytes = block_bytes(out.format);
+    auto columns = block_count(out.width);
+    for(int by = first; by < last; ++by) {
+        for(int bx = 0; bx < columns; ++bx) {
+            auto t = bc::fetch(source, bx, by);
+            auto block = out.blocks.data()
+                + (std::size_t(by) * std::size_t(columns) + std::size_t(bx)) * bytes;
+            switch(out.format) {
+            case BlockFormat::bc1:
+                bc::encode_bc1(t, block);
+                break;
+            case BlockFormat::bc3:
+                bc::encode_bc4(t, 3, block);
+                bc::encode_bc1(t, block + 8);
+                break;
+            case BlockFormat::bc7:
+                bc::encode_bc7(t, block);
+                break;
+            }
+        }
+    }
+}
+
+inline
+BlockImage compress(const Rgba8& source, BlockFormat format) {
+    auto out = block_image(source.width, source.height, format);
+    compress_rows(source, out, 0, block_count(source.height));
+    return out;
+}
+
+// Missing channels are 0 for color and 255 for alpha.
+inline
+Rgba8 decompress(const BlockImage& bi) {
+    auto out = rgba8(bi.width, bi.height);
+    auto bytes = block_bytes(bi.format);
+    auto columns = block_count(bi.width);
+    for(int by = 0; by < block_count(bi.height); ++by) {
+        for(int bx = 0; bx < columns; ++bx) {
+            auto block = bi.blocks.data()
+                + (std::size_t(by) * std::size_t(columns) + std::size_t(bx)) * bytes;
+            auto t = bc::Texels();
+            for(auto& texel : t) {
+                texel = {0, 0, 0, 255};
+            }
+            switch(bi.format) {
+            case BlockFormat::bc1:
+                bc::decode_bc1(block, t);
+                break;
+            case BlockFormat::bc3:
+                bc::decode_bc4(block, 3, t);
+                bc::decode_bc1(block + 8, t);
+                break;
+            case BlockFormat::bc7:
+                bc::decode_bc7(block, t);
+                break;
+            }
+            for(int y = 0; y < 4 and 4 * by + y < bi.height; ++y) {
+                for(int x = 0; x < 4 and 4 * bx + x < bi.width; ++x) {
+                    auto p = out.pixels.data() + 4 * (std::size_t(4 * by + y)
+                        * std::size_t(bi.width) + std::size_t(4 * bx + x));
+                    std::copy(begin(t[4 * y + x]), end(t[4 * y + x]), p);
+                }
+            }
+        }
+    }
+    return out;
+}
+
+// BC1 when opaque, BC7 otherwise, or BC3 where BC7 cannot be sampled.
+inline
+BlockFormat color_block_format(const Rgba8& i, bool has_bc7 = true) {
+    for(std::size_t p = 3; p < size(i.pixels); p += 4) {
+        if(i.pixels[p] != 255) {
+            return has_bc7 ? BlockFormat::bc7 : BlockFormat::bc3;
+        }
+    }
+    return BlockFormat::bc1;
+}
+
+}
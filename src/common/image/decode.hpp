@@ -0,0 +1,40 @@
+#pragma once
+
+#include "image.hpp"
+
+#include <stb_image.h>
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace image {
+
+// Any format supported by stb_image, expanded to RGBA.
+// 'STB_IMAGE_IMPLEMENTATION' must be defined in one translation unit.
+// Thread safe.
+inline
+Rgba8 decode(std::span<const std::byte> encoded) {
+    if(size(encoded) > std::size_t(INT_MAX)) {
+        throw std::runtime_error("Image too large to decode.");
+    }
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    auto pixels = stbi_load_from_memory(
+        reinterpret_cast<const stbi_uc*>(encoded.data()), int(size(encoded)),
+        &width, &height, &channels, 4);
+    if(pixels == nullptr) {
+        throw std::runtime_error(
+            std::string("Failed to decode image: ") + stbi_failure_reason());
+    }
+    auto i = rgba8(width, height);
+    std::memcpy(i.pixels.data(), pixels, size_bytes(i));
+    stbi_image_free(pixels);
+    return i;
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace image {
+
+// Tightly packed 8 bit RGBA, rows top to bottom.
+struct Rgba8 {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> pixels;
+};
+
+inline
+Rgba8 rgba8(int width, int height) {
+    auto i = Rgba8();
+    i.width = width;
+    i.height = height;
+    i.pixels.resize(4 * std::size_t(width) * std::size_t(height));
+    return i;
+}
+
+inline
+std::size_t size_bytes(const Rgba8& i) noexcept {
+    return size(i.pixels);
+}
+
+inline
+std::size_t row_bytes(const Rgba8& i) noexcept {
+    return 4 * std::size_t(i.width);
+}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "image.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define IMAGE_X64 1
+#include <emmintrin.h>
+#endif
+
+namespace image {
+
+namespace scalar {
+
+// Output pixels [first, last) of a row, from source rows 'r0' and 'r1'.
+inline
+void box_filter_row(
+    const std::uint8_t* r0,
+    const std::uint8_t* r1,
+    int source_width,
+    std::uint8_t* out,
+    int first,
+    int last)
+{
+    for(int x = first; x < last; ++x) {
+        auto x0 = 2 * x;
+        auto x1 = std::min(2 * x + 1, source_width - 1);
+        for(int c = 0; c < 4; ++c) {
+            out[4 * x + c] = std::uint8_t((
+                r0[4 * x0 + c] + r0[4 * x1 + c]
+                + r1[4 * x0 + c] + r1[4 * x1 + c]
+                + 2) >> 2);
+        }
+    }
+}
+
+}
+
+#ifdef IMAGE_X64
+namespace sse2 {
+
+// Four output pixels from four source pixels of each row.
+inline
+__m128i box_filter_4(
+    const std::uint8_t* r0,
+    const std::uint8_t* r1)
+{
+    auto zero = _mm_setzero_si128();
+    // Sums of the two pixels of each 64 bit half, as 16 bit channels.
+    auto sum_2 = [&](__m128i a, __m128i b) {
+        auto lo = _mm_add_epi16(
+            _mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        auto hi = _mm_add_epi16(
+            _mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+        hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+        return _mm_unpacklo_epi64(lo, hi);
+    };
+    auto round = _mm_set1_epi16(2);
+    auto s0 = sum_2(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1)));
+    auto s1 = sum_2(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + 16)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + 16)));
+    s0 = _mm_srli_epi16(_mm_add_epi16(s0, round), 2);
+    s1 = _mm_srli_epi16(_mm_add_epi16(s1, round), 2);
+    return _mm_packus_epi16(s0, s1);
+}
+
+inline
+void box_filter_row(
+    const std::uint8_t* r0,
+    const std::uint8_t* r1,
+    int source_width,
+    std::uint8_t* out,
+    int width)
+{
+    auto x = 0;
+    // Only while the 8 source pixels are in the row, no clamping needed.
+    for(; 2 * x + 8 <= source_width and x + 4 <= width; x += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * x),
+            box_filter_4(r0 + 8 * x, r1 + 8 * x));
+    }
+    scalar::box_filter_row(r0, r1, source_width, out, x, width);
+}
+
+}
+#endif
+
+// Half the size rounded down, at least 1, averaging 2x2 blocks.
+// The last row or column of odd sizes is repeated.
+inline
+Rgba8 downsample(const Rgba8& source) {
+    auto d = rgba8(
+        std::max(source.width / 2, 1),
+        std::max(source.height / 2, 1));
+    for(int y = 0; y < d.height; ++y) {
+        auto r0 = source.pixels.data() + row_bytes(source) * std::size_t(2 * y);
+        auto r1 = source.pixels.data() + row_bytes(source)
+            * std::size_t(std::min(2 * y + 1, source.height - 1));
+        auto out = d.pixels.data() + row_bytes(d) * std::size_t(y);
+#ifdef IMAGE_X64
+        sse2::box_filter_row(r0, r1, source.width, out, d.width);
+#else
+        scalar::box_filter_row(r0, r1, source.width, out, 0, d.width);
+#endif
+    }
+    return d;
+}
+
+inline
+int mip_level_count(int width, int height) {
+    auto levels = 1;
+    while(width > 1 or height > 1) {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        levels += 1;
+    }
+    return levels;
+}
+
+// Down to 1x1, 'base' first.
+inline
+std::vector<Rgba8> mip_chain(Rgba8 base) {
+    auto levels = std::vector<Rgba8>();
+    levels.reserve(std::size_t(mip_level_count(base.width, base.height)));
+    levels.push_back(std::move(base));
+    while(levels.back().width > 1 or levels.back().height > 1) {
+        levels.push_back(downsample(levels.back()));
+    }
+    return levels;
+}
+
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "overdraw.hpp"
+#include "vertex_cache.hpp"
+#include "vertex_fetch.hpp"
+#include "vertex_quantization.hpp"
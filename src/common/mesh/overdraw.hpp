@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+namespace mesh {
+
+// Sorts clusters of triangles so that outward facing ones come first,
+// which lets them occlude the rest of the mesh when depth testing.
+// Clusters end where the FIFO cache of 'cache_size' entries would restart,
+// so the vertex cache order within each cluster is preserved.
+// 'positions' holds three floats per vertex.
+inline
+void optimize_overdraw(
+    std::span<std::uint32_t> indices,
+    std::span<const float> positions,
+    std::size_t cache_size = 16)
+{
+    auto triangle_count = size(indices) / 3;
+    auto vertex_count = size(positions) / 3;
+    if(triangle_count < 2) {
+        return;
+    }
+
+    auto cluster_offsets = std::vector<std::size_t>();
+    { // Clusters.
+        auto timestamps = std::vector<std::size_t>(vertex_count, 0);
+        auto time = cache_size + 1;
+        for(std::size_t t = 0; t < triangle_count; ++t) {
+            auto misses = 0;
+            for(std::size_t k = 0; k < 3; ++k) {
+                auto i = indices[3 * t + k];
+                if(time - timestamps[i] > cache_size) {
+                    timestamps[i] = time++;
+                    ++misses;
+                }
+            }
+            if(t == 0 or misses == 3) {
+                cluster_offsets.push_back(t);
+            }
+        }
+        cluster_offsets.push_back(triangle_count);
+    }
+    auto cluster_count = size(cluster_offsets) - 1;
+    if(cluster_count < 2) {
+        return;
+    }
+
+    auto position = [&](std::uint32_t i) {
+        return std::array<float, 3>{
+            positions[3 * i + 0],
+            positions[3 * i + 1],
+            positions[3 * i + 2]};
+    };
+
+    // Area weighted centroids and normals.
+    auto centroids = std::vector<std::array<float, 3>>(cluster_count);
+    auto normals = std::vector<std::array<float, 3>>(cluster_count);
+    auto mesh_centroid = std::array<float, 3>{};
+    auto mesh_area = 0.f;
+    for(std::size_t c = 0; c < cluster_count; ++c) {
+        auto centroid = std::array<float, 3>{};
+        auto normal = std::array<float, 3>{};
+        auto area = 0.f;
+        for(auto t = cluster_offsets[c]; t < cluster_offsets[c + 1]; ++t) {
+            auto p0 = position(indices[3 * t + 0]);
+            auto p1 = position(indices[3 * t + 1]);
+            auto p2 = position(indices[3 * t + 2]);
+            auto e1 = std::array<float, 3>{p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            auto e2 = std::array<float, 3>{p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            auto n = std::array<float, 3>{
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0]};
+            auto a = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for(int k = 0; k < 3; ++k) {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.f * a;
+                normal[k] += n[k];
+            }
+            area += a;
+        }
+        for(int k = 0; k < 3; ++k) {
+            mesh_centroid[k] += centroid[k];
+            centroids[c][k] = (area > 0.f) ? centroid[k] / area : 0.f;
+        }
+        mesh_area += area;
+        normals[c] = normal;
+    }
+    for(int k = 0; k < 3; ++k) {
+        mesh_centroid[k] = (mesh_area > 0.f) ? mesh_centroid[k] / mesh_area : 0.f;
+    }
+
+    auto keys = std::vector<float>(cluster_count);
+    for(std::size_t c = 0; c < cluster_count; ++c) {
+        auto& n = normals[c];
+        auto length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if(length > 0.f) {
+            for(int k = 0; k < 3; ++k) {
+                keys[c] += (centroids[c][k] - mesh_centroid[k]) * n[k] / length;
+            }
+        }
+    }
+    auto order = std::vector<std::size_t>(cluster_count);
+    for(std::size_t c = 0; c < cluster_count; ++c) {
+        order[c] = c;
+    }
+    std::stable_sort(begin(order), end(order), [&](auto l, auto r) {
+        return keys[l] > keys[r];
+    });
+
+    auto sorted = std::vector<std::uint32_t>();
+    sorted.reserve(size(indices));
+    for(auto c : order) {
+        sorted.insert(end(sorted),
+            begin(indices) + 3 * cluster_offsets[c],
+            begin(indices) + 3 * cluster_offsets[c + 1]);
+    }
+    std::copy(begin(sorted), end(sorted), begin(indices));
+}
+
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+namespace mesh {
+
+struct VertexCacheStats {
+    // Average cache miss ratio, transformed vertices per triangle.
+    float acmr = 0.f;
+    // Average transform to vertex ratio, 1 is optimal.
+    float atvr = 0.f;
+};
+
+// Simulates a FIFO post transform cache, as found on most hardware.
+inline
+VertexCacheStats analyze_vertex_cache(
+    std::span<const std::uint32_t> indices,
+    std::size_t vertex_count,
+    std::size_t cache_size = 16)
+{
+    auto stats = VertexCacheStats();
+    auto triangle_count = size(indices) / 3;
+    if(triangle_count == 0) {
+        return stats;
+    }
+    // Vertex 'v' is cached while 'time - timestamps[v] < cache_size'.
+    auto timestamps = std::vector<std::size_t>(vertex_count, 0);
+    auto time = cache_size + 1;
+    auto misses = std::size_t(0);
+    auto used_count = std::size_t(0);
+    for(auto i : indices) {
+        if(timestamps[i] == 0) {
+            ++used_count;
+        }
+        if(time - timestamps[i] > cache_size) {
+            timestamps[i] = time++;
+            ++misses;
+        }
+    }
+    stats.acmr = float(misses) / float(triangle_count);
+    stats.atvr = float(misses) / float(used_count);
+    return stats;
+}
+
+// Tom Forsyth's linear-speed vertex cache optimization.
+// Reorders triangles so that they reuse recently transformed vertices.
+inline
+void optimize_vertex_cache(
+    std::span<std::uint32_t> indices,
+    std::size_t vertex_count)
+{
+    constexpr auto cache_size = 32;
+    constexpr auto no_triangle = ~std::uint32_t(0);
+
+    auto triangle_count = size(indices) / 3;
+    if(triangle_count == 0) {
+        return;
+    }
+
+    auto score = [](int cache_position, std::uint32_t valence) {
+        if(valence == 0) {
+            return -1.f;
+        }
+        auto s = 0.f;
+        if(cache_position < 0) {
+            // Not cached.
+        } else if(cache_position < 3) {
+            // Used by the last triangle, fixed score to avoid favoring a strip.
+            s = 0.75f;
+        } else {
+            s = std::pow(1.f - float(cache_position - 3) / float(cache_size - 3), 1.5f);
+        }
+        // Favors vertices with few remaining triangles to avoid leaving holes.
+        return s + 2.f / std::sqrt(float(valence));
+    };
+
+    // Triangles adjacent to each vertex, live ones first.
+    auto live = std::vector<std::uint32_t>(vertex_count, 0);
+    for(auto i : indices) {
+        ++live[i];
+    }
+    auto offsets = std::vector<std::uint32_t>(vertex_count + 1, 0);
+    for(std::size_t v = 0; v < vertex_count; ++v) {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    auto adjacency = std::vector<std::uint32_t>(size(indices));
+    {
+        auto filled = std::vector<std::uint32_t>(begin(offsets), end(offsets) - 1);
+        for(std::size_t ii = 0; ii < size(indices); ++ii) {
+            adjacency[filled[indices[ii]]++] = std::uint32_t(ii / 3);
+        }
+    }
+
+    auto cache_positions = std::vector<int>(vertex_count, -1);
+    auto vertex_scores = std::vector<float>(vertex_count);
+    for(std::size_t v = 0; v < vertex_count; ++v) {
+        vertex_scores[v] = score(-1, live[v]);
+    }
+    auto triangle_scores = std::vector<float>(triangle_count);
+    auto is_emitted = std::vector<char>(triangle_count, false);
+    auto best = no_triangle;
+    for(std::size_t t = 0; t < triangle_count; ++t) {
+        triangle_scores[t]
+        = vertex_scores[indices[3 * t + 0]]
+        + vertex_scores[indices[3 * t + 1]]
+        + vertex_scores[indices[3 * t + 2]];
+        if(best == no_triangle or triangle_scores[t] > triangle_scores[best]) {
+            best = std::uint32_t(t);
+        }
+    }
+
+    auto output = std::vector<std::uint32_t>();
+    output.reserve(size(indices));
+    // Three extra slots hold the vertices pushed out by the last triangle.
+    auto cache = std::array<std::uint32_t, cache_size + 3>();
+    auto cache_count = std::size_t(0);
+    auto cursor = std::size_t(0);
+    while(size(output) < size(indices)) {
+        if(best == no_triangle) {
+            // Nothing left around the cache, restart from the input order.
+            while(is_emitted[cursor]) {
+                ++cursor;
+            }
+            best = std::uint32_t(cursor);
+        }
+        auto triangle = std::array<std::uint32_t, 3>{
+            indices[3 * best + 0],
+            indices[3 * best + 1],
+            indices[3 * best + 2]};
+        output.insert(end(output), begin(triangle), end(triangle));
+        is_emitted[best] = true;
+        for(auto v : triangle) {
+            auto first = begin(adjacency) + offsets[v];
+            auto last = first + live[v];
+            std::iter_swap(std::find(first, last, best), last - 1);
+            --live[v];
+        }
+        { // Cache update, the new triangle goes in front.
+            auto next = std::array<std::uint32_t, cache_size + 3>();
+            auto next_count = std::size_t(0);
+            for(auto v : triangle) {
+                if(std::find(begin(next), begin(next) + next_count, v)
+                    == begin(next) + next_count)
+                {
+                    next[next_count++] = v;
+                }
+            }
+            for(std::size_t ci = 0; ci < cache_count; ++ci) {
+                auto v = cache[ci];
+                if(std::find(begin(next), begin(next) + next_count, v)
+                    != begin(next) + next_count)
+                {
+                    continue;
+                }
+                if(next_count < size(next)) {
+                    next[next_count++] = v;
+                } else {
+                    cache_positions[v] = -1;
+                    vertex_scores[v] = score(-1, live[v]);
+                }
+            }
+            cache = next;
+            cache_count = next_count;
+        }
+        best = no_triangle;
+        for(std::size_t ci = 0; ci < cache_count; ++ci) {
+            auto v = cache[ci];
+            cache_positions[v] = (ci < cache_size) ? int(ci) : -1;
+            vertex_scores[v] = score(cache_positions[v], live[v]);
+        }
+        for(std::size_t ci = 0; ci < cache_count; ++ci) {
+            auto v = cache[ci];
+            for(auto ai = offsets[v]; ai < offsets[v] + live[v]; ++ai) {
+                auto t = adjacency[ai];
+                triangle_scores[t]
+                = vertex_scores[indices[3 * t + 0]]
+                + vertex_scores[indices[3 * t + 1]]
+                + vertex_scores[indices[3 * t + 2]];
+                if(best == no_triangle or triangle_scores[t] > triangle_scores[best]) {
+                    best = t;
+                }
+            }
+        }
+    }
+    std::copy(begin(output), end(output), begin(indices));
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace mesh {
+
+// Renumbers vertices in order of first use so that consecutive triangles
+// fetch neighbouring memory. Unused vertices are moved to the end.
+// Rewrites 'indices' and returns the new index of every vertex.
+inline
+std::vector<std::uint32_t> optimize_vertex_fetch(
+    std::span<std::uint32_t> indices,
+    std::size_t vertex_count)
+{
+    constexpr auto unassigned = ~std::uint32_t(0);
+    auto remap = std::vector<std::uint32_t>(vertex_count, unassigned);
+    auto next = std::uint32_t(0);
+    for(auto& i : indices) {
+        if(remap[i] == unassigned) {
+            remap[i] = next++;
+        }
+        i = remap[i];
+    }
+    for(auto& r : remap) {
+        if(r == unassigned) {
+            r = next++;
+        }
+    }
+    return remap;
+}
+
+// 'destination[remap[v]] = source[v]' for vertices of 'element_size' bytes.
+inline
+void remap_vertices(
+    void* destination,
+    const void* source,
+    std::size_t element_size,
+    std::span<const std::uint32_t> remap)
+{
+    auto d = static_cast<std::byte*>(destination);
+    auto s = static_cast<const std::byte*>(source);
+    for(std::size_t v = 0; v < size(remap); ++v) {
+        std::memcpy(d + remap[v] * element_size, s + v * element_size, element_size);
+    }
+}
+
+// Smallest index size in bytes able to address 'vertex_count' vertices.
+inline
+std::size_t index_size(std::size_t vertex_count, bool allow_bytes) {
+    if(allow_bytes and vertex_count <= 0x100) {
+        return 1;
+    } else if(vertex_count <= 0x10000) {
+        return 2;
+    } else {
+        return 4;
+    }
+}
+
+// Copies 32 bit indices into a buffer of 'size' bytes per index.
+inline
+void narrow_indices(
+    void* destination,
+    std::span<const std::uint32_t> indices,
+    std::size_t size)
+{
+    auto d = static_cast<std::byte*>(destination);
+    for(auto i : indices) {
+        if(size == 1) {
+            auto narrow = std::uint8_t(i);
+            std::memcpy(d, &narrow, 1);
+        } else if(size == 2) {
+            auto narrow = std::uint16_t(i);
+            std::memcpy(d, &narrow, 2);
+        } else {
+            std::memcpy(d, &i, 4);
+        }
+        d += size;
+    }
+}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace mesh {
+
+// IEEE 754 binary16, rounded to nearest even.
+inline
+std::uint16_t half(float value) noexcept {
+    auto bits = std::bit_cast<std::uint32_t>(value);
+    auto sign = std::uint32_t((bits >> 16) & 0x8000u);
+    auto exponent = int((bits >> 23) & 0xffu) - 127 + 15;
+    auto mantissa = bits & 0x7fffffu;
+    if(((bits >> 23) & 0xffu) == 0xffu) {
+        // Infinity or NaN.
+        return std::uint16_t(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+    }
+    if(exponent >= 31) {
+        // Overflow.
+        return std::uint16_t(sign | 0x7c00u);
+    }
+    if(exponent <= 0) {
+        if(exponent < -10) {
+            return std::uint16_t(sign);
+        }
+        // Subnormal.
+        mantissa |= 0x800000u;
+        auto shift = std::uint32_t(14 - exponent);
+        auto h = mantissa >> shift;
+        auto remainder = mantissa & ((1u << shift) - 1);
+        auto halfway = 1u << (shift - 1);
+        if(remainder > halfway or (remainder == halfway and (h & 1) != 0)) {
+            ++h;
+        }
+        return std::uint16_t(sign | h);
+    }
+    auto h = sign | (std::uint32_t(exponent) << 10) | (mantissa >> 13);
+    auto remainder = mantissa & 0x1fffu;
+    // A carry into the exponent is the correct rounding.
+    if(remainder > 0x1000u or (remainder == 0x1000u and (h & 1) != 0)) {
+        ++h;
+    }
+    return std::uint16_t(h);
+}
+
+// Maps [-1, 1] to the full signed range.
+inline
+std::int16_t snorm16(float value) noexcept {
+    return std::int16_t(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+// Maps [0, 1] to the full unsigned range.
+inline
+std::uint16_t unorm16(float value) noexcept {
+    return std::uint16_t(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+}
+
+// Octahedral encoding of a unit vector into two signed normalized values.
+// Decoding is done by the vertex shader.
+inline
+std::array<std::int16_t, 2> octahedral_snorm16(float x, float y, float z) noexcept {
+    auto l1 = std::abs(x) + std::abs(y) + std::abs(z);
+    if(l1 == 0.f) {
+        return {0, 0};
+    }
+    auto u = x / l1;
+    auto v = y / l1;
+    if(z < 0.f) {
+        auto sign_u = (u >= 0.f) ? 1.f : -1.f;
+        auto sign_v = (v >= 0.f) ? 1.f : -1.f;
+        auto folded_u = (1.f - std::abs(v)) * sign_u;
+        auto folded_v = (1.f - std::abs(u)) * sign_v;
+        u = folded_u;
+        v = folded_v;
+    }
+    return {snorm16(u), snorm16(v)};
+}
+
+}
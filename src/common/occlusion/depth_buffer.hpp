@@ -0,0 +1,253 @@
+#pragma once
+
+#include "common/dependency/glm.hpp"
+#include "common/geometry/aabb.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define OCCLUSION_SSE 1
+#include <immintrin.h>
+#endif
+
+// Low resolution software depth buffer for occlusion culling.
+// Depth is 'z / w' remapped to [0, 1], 1 is the far plane.
+namespace occlusion {
+
+struct Level {
+    int width = 0;
+    int height = 0;
+    std::vector<float> depth;
+};
+
+struct DepthBuffer {
+    // Level 0 is rasterized, every next level keeps the farthest depth of
+    // 2x2 texels of the previous one.
+    std::vector<Level> levels;
+};
+
+// 'width' is rounded up to a multiple of 4 for the SIMD rows.
+inline
+DepthBuffer depth_buffer(int width, int height) {
+    auto db = DepthBuffer();
+    width = (width + 3) & ~3;
+    while(true) {
+        auto& l = db.levels.emplace_back();
+        l.width = width;
+        l.height = height;
+        l.depth.assign(std::size_t(width) * std::size_t(height), 1.f);
+        if(width == 1 and height == 1) {
+            break;
+        }
+        width = std::max(1, (width + 1) / 2);
+        height = std::max(1, (height + 1) / 2);
+    }
+    return db;
+}
+
+inline
+void clear(DepthBuffer& db) {
+    auto& l = db.levels.front();
+    std::fill(begin(l.depth), end(l.depth), 1.f);
+}
+
+// Outside the clip space near plane, where the GPU clips, so not projected.
+// Projecting them anyway gives depths nearer than anything drawn.
+inline
+bool is_behind_near_plane(const glm::vec4& clip_position) {
+    return clip_position.w <= 0.f or clip_position.z < -clip_position.w;
+}
+
+// Rasterizes the triangles 'indices' of 'clip_positions' into level 0.
+// Triangles crossing the near plane are skipped, which only loses occlusion.
+// Returns the number of rasterized triangles.
+inline
+std::size_t rasterize(
+    DepthBuffer& db,
+    std::span<const glm::vec4> clip_positions,
+    std::span<const std::uint32_t> indices)
+{
+    auto& l = db.levels.front();
+    auto w = float(l.width);
+    auto h = float(l.height);
+    auto rasterized = std::size_t(0);
+    for(std::size_t t = 0; t + 2 < size(indices); t += 3) {
+        glm::vec3 v[3];
+        auto is_clipped = false;
+        for(int k = 0; k < 3; ++k) {
+            auto& c = clip_positions[indices[t + k]];
+            if(is_behind_near_plane(c)) {
+                is_clipped = true;
+                break;
+            }
+            auto inv_w = 1.f / c.w;
+            v[k] = glm::vec3(
+                (c.x * inv_w * 0.5f + 0.5f) * w,
+                (c.y * inv_w * 0.5f + 0.5f) * h,
+                c.z * inv_w * 0.5f + 0.5f);
+        }
+        if(is_clipped) {
+            continue;
+        }
+        auto area = (v[1].x - v[0].x) * (v[2].y - v[0].y)
+            - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if(std::abs(area) < 1e-6f) {
+            continue;
+        }
+        // Both windings are occluders.
+        if(area < 0.f) {
+            std::swap(v[1], v[2]);
+            area = -area;
+        }
+        auto x0 = std::max(0, int(std::floor(std::min({v[0].x, v[1].x, v[2].x}))));
+        auto x1 = std::min(l.width - 1, int(std::ceil(std::max({v[0].x, v[1].x, v[2].x}))));
+        auto y0 = std::max(0, int(std::floor(std::min({v[0].y, v[1].y, v[2].y}))));
+        auto y1 = std::min(l.height - 1, int(std::ceil(std::max({v[0].y, v[1].y, v[2].y}))));
+        if(x0 > x1 or y0 > y1) {
+            continue;
+        }
+        x0 &= ~3;
+        rasterized += 1;
+        // Edge functions of the edges opposite to each vertex, at the center
+        // of pixel (x0, y0), and their steps along x and y.
+        float e[3], dx[3], dy[3];
+        for(int k = 0; k < 3; ++k) {
+            auto& a = v[(k + 1) % 3];
+            auto& b = v[(k + 2) % 3];
+            dx[k] = -(b.y - a.y);
+            dy[k] = b.x - a.x;
+            e[k] = (b.x - a.x) * (float(y0) + 0.5f - a.y)
+                - (b.y - a.y) * (float(x0) + 0.5f - a.x);
+        }
+        // Depth is linear in screen space.
+        auto inv_area = 1.f / area;
+        auto z = (e[0] * v[0].z + e[1] * v[1].z + e[2] * v[2].z) * inv_area;
+        auto dz_dx = (dx[0] * v[0].z + dx[1] * v[1].z + dx[2] * v[2].z) * inv_area;
+        auto dz_dy = (dy[0] * v[0].z + dy[1] * v[1].z + dy[2] * v[2].z) * inv_area;
+        for(int y = y0; y <= y1; ++y) {
+            auto row = l.depth.data() + std::size_t(y) * std::size_t(l.width);
+            auto dy_count = float(y - y0);
+            auto e0 = e[0] + dy[0] * dy_count;
+            auto e1 = e[1] + dy[1] * dy_count;
+            auto e2 = e[2] + dy[2] * dy_count;
+            auto zr = z + dz_dy * dy_count;
+#ifdef OCCLUSION_SSE
+            auto lane = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+            auto step0 = _mm_mul_ps(_mm_set1_ps(dx[0]), lane);
+            auto step1 = _mm_mul_ps(_mm_set1_ps(dx[1]), lane);
+            auto step2 = _mm_mul_ps(_mm_set1_ps(dx[2]), lane);
+            auto step_z = _mm_mul_ps(_mm_set1_ps(dz_dx), lane);
+            auto zero = _mm_setzero_ps();
+            for(int x = x0; x <= x1; x += 4) {
+                auto count = float(x - x0);
+                auto w0 = _mm_add_ps(_mm_set1_ps(e0 + dx[0] * count), step0);
+                auto w1 = _mm_add_ps(_mm_set1_ps(e1 + dx[1] * count), step1);
+                auto w2 = _mm_add_ps(_mm_set1_ps(e2 + dx[2] * count), step2);
+                auto inside = _mm_and_ps(
+                    _mm_cmpge_ps(w0, zero),
+                    _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero)));
+                if(_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                auto depth = _mm_add_ps(_mm_set1_ps(zr + dz_dx * count), step_z);
+                auto old = _mm_loadu_ps(row + x);
+                auto nearer = _mm_min_ps(old, depth);
+                _mm_storeu_ps(row + x, _mm_or_ps(
+                    _mm_and_ps(inside, nearer),
+                    _mm_andnot_ps(inside, old)));
+            }
+#else
+            for(int x = x0; x <= x1 and x < l.width; ++x) {
+                auto count = float(x - x0);
+                if(e0 + dx[0] * count >= 0.f
+                    and e1 + dx[1] * count >= 0.f
+                    and e2 + dx[2] * count >= 0.f)
+                {
+                    row[x] = std::min(row[x], zr + dz_dx * count);
+                }
+            }
+#endif
+        }
+    }
+    return rasterized;
+}
+
+// Rebuilds every level above 0.
+inline
+void build_pyramid(DepthBuffer& db) {
+    for(std::size_t li = 1; li < size(db.levels); ++li) {
+        auto& src = db.levels[li - 1];
+        auto& dst = db.levels[li];
+        for(int y = 0; y < dst.height; ++y) {
+            auto sy0 = std::min(2 * y, src.height - 1);
+            auto sy1 = std::min(2 * y + 1, src.height - 1);
+            for(int x = 0; x < dst.width; ++x) {
+                auto sx0 = std::min(2 * x, src.width - 1);
+                auto sx1 = std::min(2 * x + 1, src.width - 1);
+                dst.depth[std::size_t(y) * dst.width + x] = std::max(
+                    std::max(
+                        src.depth[std::size_t(sy0) * src.width + sx0],
+                        src.depth[std::size_t(sy0) * src.width + sx1]),
+                    std::max(
+                        src.depth[std::size_t(sy1) * src.width + sx0],
+                        src.depth[std::size_t(sy1) * src.width + sx1]));
+            }
+        }
+    }
+}
+
+// True when 'b' is entirely behind the depth of the pyramid.
+// Conservative: boxes crossing the near plane are never occluded.
+inline
+bool is_occluded(
+    const DepthBuffer& db,
+    const Aabb& b,
+    const glm::mat4& world_to_clip)
+{
+    auto& base = db.levels.front();
+    auto screen = Aabb();
+    for(int k = 0; k < 8; ++k) {
+        auto corner = glm::vec4(
+            (k & 1) ? b.max.x : b.min.x,
+            (k & 2) ? b.max.y : b.min.y,
+            (k & 4) ? b.max.z : b.min.z,
+            1.f);
+        auto c = world_to_clip * corner;
+        if(is_behind_near_plane(c)) {
+            return false;
+        }
+        extend(screen, glm::vec3(
+            (c.x / c.w * 0.5f + 0.5f) * float(base.width),
+            (c.y / c.w * 0.5f + 0.5f) * float(base.height),
+            c.z / c.w * 0.5f + 0.5f));
+    }
+    auto x0 = std::max(0, int(std::floor(screen.min.x)));
+    auto x1 = std::min(base.width - 1, int(std::floor(screen.max.x)));
+    auto y0 = std::max(0, int(std::floor(screen.min.y)));
+    auto y1 = std::min(base.height - 1, int(std::floor(screen.max.y)));
+    if(x0 > x1 or y0 > y1) {
+        return false;
+    }
+    // Coarsest level where the rectangle spans at most 4x4 texels.
+    auto li = std::size_t(0);
+    while(li + 1 < size(db.levels) and ((x1 >> li) - (x0 >> li) > 3
+        or (y1 >> li) - (y0 >> li) > 3))
+    {
+        ++li;
+    }
+    auto& l = db.levels[li];
+    auto farthest = 0.f;
+    for(int y = y0 >> li; y <= std::min(y1 >> li, l.height - 1); ++y) {
+        for(int x = x0 >> li; x <= std::min(x1 >> li, l.width - 1); ++x) {
+            farthest = std::max(farthest, l.depth[std::size_t(y) * l.width + x]);
+        }
+    }
+    return screen.min.z > farthest;
+}
+
+}
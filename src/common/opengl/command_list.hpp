@@ -0,0 +1,174 @@
+#pragma once
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/dependency/glm.hpp"
+
+#include <cstdlib>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace command {
+
+struct UseProgram {
+    GLuint program;
+};
+
+struct BindVertexArray {
+    GLuint vertex_array;
+};
+
+struct SetCapability {
+    GLenum capability;
+    bool is_enabled;
+};
+
+struct UniformMatrix4 {
+    GLuint program;
+    GLint location;
+    glm::mat4 value;
+};
+
+struct DrawArrays {
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+};
+
+// Indexed, offset by the base instance given to 'execute'.
+struct DrawElements {
+    GLenum mode;
+    GLsizei count;
+    GLenum type;
+    // Bytes into the element buffer.
+    std::size_t index_offset;
+    GLsizei instance_count;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+}
+
+using Command = std::variant<
+    command::UseProgram,
+    command::BindVertexArray,
+    command::SetCapability,
+    command::UniformMatrix4,
+    command::DrawArrays,
+    command::DrawElements>;
+
+// GL calls recorded without a context, so any thread can record one, and
+// replayed in order by 'execute' on the context thread.
+// A list can be executed again as long as the objects it names are alive.
+struct CommandList {
+    std::vector<Command> commands;
+    // Bound by the recorded commands so far, 0 if none.
+    GLuint program = 0;
+    GLuint vertex_array = 0;
+};
+
+// Keeps the allocation.
+inline
+void clear(CommandList& cl) {
+    cl.commands.clear();
+    cl.program = 0;
+    cl.vertex_array = 0;
+}
+
+// Skipped if already bound by the list.
+inline
+void use_program(CommandList& cl, GLuint program) {
+    if(program != cl.program) {
+        cl.commands.push_back(command::UseProgram{program});
+        cl.program = program;
+    }
+}
+
+// Skipped if already bound by the list.
+inline
+void bind_vertex_array(CommandList& cl, GLuint vertex_array) {
+    if(vertex_array != cl.vertex_array) {
+        cl.commands.push_back(command::BindVertexArray{vertex_array});
+        cl.vertex_array = vertex_array;
+    }
+}
+
+inline
+void enable(CommandList& cl, GLenum capability) {
+    cl.commands.push_back(command::SetCapability{capability, true});
+}
+
+inline
+void disable(CommandList& cl, GLenum capability) {
+    cl.commands.push_back(command::SetCapability{capability, false});
+}
+
+inline
+void uniform(
+    CommandList& cl,
+    GLuint program,
+    GLint location,
+    const glm::mat4& value)
+{
+    cl.commands.push_back(command::UniformMatrix4{program, location, value});
+}
+
+inline
+void draw_arrays(CommandList& cl, GLenum mode, GLint first, GLsizei count) {
+    cl.commands.push_back(command::DrawArrays{mode, first, count});
+}
+
+inline
+void draw_elements(
+    CommandList& cl,
+    GLenum mode,
+    GLsizei count,
+    GLenum type,
+    std::size_t index_offset,
+    GLsizei instance_count = 1,
+    GLint base_vertex = 0,
+    GLuint base_instance = 0)
+{
+    cl.commands.push_back(command::DrawElements{mode, count, type,
+        index_offset, instance_count, base_vertex, base_instance});
+}
+
+// Issues the commands of 'cl' to the current context, 'base_instance' is
+// added to the base instance of every 'DrawElements'.
+// Returns the number of draw calls.
+inline
+std::size_t execute(const CommandList& cl, GLuint base_instance = 0) {
+    auto draw_calls = std::size_t(0);
+    for(auto& c : cl.commands) {
+        std::visit([&](auto& args) {
+            using Args = std::decay_t<decltype(args)>;
+            if constexpr(std::is_same_v<Args, command::UseProgram>) {
+                glUseProgram(args.program);
+            } else if constexpr(std::is_same_v<Args, command::BindVertexArray>) {
+                glBindVertexArray(args.vertex_array);
+            } else if constexpr(std::is_same_v<Args, command::SetCapability>) {
+                if(args.is_enabled) {
+                    glEnable(args.capability);
+                } else {
+                    glDisable(args.capability);
+                }
+            } else if constexpr(std::is_same_v<Args, command::UniformMatrix4>) {
+                glProgramUniformMatrix4fv(args.program, args.location,
+                    1, GL_FALSE, &args.value[0][0]);
+            } else if constexpr(std::is_same_v<Args, command::DrawArrays>) {
+                glDrawArrays(args.mode, args.first, args.count);
+                draw_calls += 1;
+            } else {
+                glDrawElementsInstancedBaseVertexBaseInstance(args.mode,
+                    args.count,
+                    args.type,
+                    reinterpret_cast<const void*>(args.index_offset),
+                    args.instance_count,
+                    args.base_vertex,
+                    base_instance + args.base_instance);
+                draw_calls += 1;
+            }
+        }, c);
+    }
+    return draw_calls;
+}
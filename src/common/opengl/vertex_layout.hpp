@@ -0,0 +1,105 @@
+#pragma once
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/glsl/shader_input.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <span>
+#include <string_view>
+
+// Vertex formats described once as constant data: the vertex array setup,
+// the strides and the checks against shader inputs all derive from it, so
+// a new packed format is a new layout and no binding code.
+
+// Read from a buffer binding and converted to floats, normalized or not.
+struct VertexAttribute {
+    // Of the matching 'glsl::ShaderInput'.
+    const char* name;
+    GLuint location;
+    GLenum type;
+    GLint count;
+    bool normalized;
+    // Bytes from the start of the vertex.
+    GLuint offset;
+    GLuint binding = 0;
+};
+
+template<std::size_t AttributeCount, std::size_t BindingCount = 1>
+struct VertexLayout {
+    std::array<VertexAttribute, AttributeCount> attributes;
+    // Bytes between consecutive vertices of each binding.
+    std::array<GLsizei, BindingCount> strides;
+};
+
+inline
+constexpr GLsizei component_size(GLenum type) {
+    switch(type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE: return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT: return 2;
+    default: return 4;
+    }
+}
+
+inline
+constexpr GLsizei attribute_size(const VertexAttribute& a) {
+    return a.count * component_size(a.type);
+}
+
+// Distinct locations, existing bindings, and every attribute aligned and
+// within the stride of its binding.
+template<std::size_t A, std::size_t B>
+constexpr bool is_valid(const VertexLayout<A, B>& l) {
+    for(std::size_t i = 0; i < A; ++i) {
+        auto& a = l.attributes[i];
+        if(a.count < 1 or a.count > 4
+            or a.binding >= B
+            or a.offset % GLuint(component_size(a.type)) != 0
+            or GLsizei(a.offset) + attribute_size(a) > l.strides[a.binding])
+        {
+            return false;
+        }
+        for(std::size_t j = 0; j < i; ++j) {
+            if(l.attributes[j].location == a.location) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Every attribute feeds an input of the same name, location and size.
+// Inputs left out keep the current attribute value, shaders only read them
+// where the vertex data has them.
+template<std::size_t A, std::size_t B, std::size_t I>
+constexpr bool matches(
+    const VertexLayout<A, B>& l,
+    const std::array<glsl::ShaderInput, I>& inputs)
+{
+    for(auto& a : l.attributes) {
+        auto found = false;
+        for(auto& i : inputs) {
+            found = found or (i.location == a.location
+                and i.count == a.count
+                and std::string_view(i.name) == std::string_view(a.name));
+        }
+        if(not found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Attribute formats and bindings of 'l' on 'va', buffers are bound apart.
+template<std::size_t A, std::size_t B>
+void set_layout(GLuint va, const VertexLayout<A, B>& l) {
+    for(auto& a : l.attributes) {
+        glVertexArrayAttribFormat(va, a.location, a.count, a.type,
+            a.normalized ? GL_TRUE : GL_FALSE, a.offset);
+        glVertexArrayAttribBinding(va, a.location, a.binding);
+        glEnableVertexArrayAttrib(va, a.location);
+    }
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "radix_sort.hpp"
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// Stable least significant digit radix sort of 'keys' and their 'values'
+// with 8 bit digits. Digits shared by every key take no pass, so narrow
+// keys cost fewer passes. The scratch vectors are resized and reused.
+template<typename V>
+void radix_sort(
+    std::vector<std::uint64_t>& keys,
+    std::vector<V>& values,
+    std::vector<std::uint64_t>& key_scratch,
+    std::vector<V>& value_scratch)
+{
+    auto n = size(keys);
+    if(n < 2) {
+        return;
+    }
+    key_scratch.resize(n);
+    value_scratch.resize(n);
+    // Histograms of every digit in one pass.
+    auto counts = std::array<std::array<std::size_t, 256>, 8>();
+    for(auto k : keys) {
+        for(int d = 0; d < 8; ++d) {
+            counts[d][(k >> (8 * d)) & 0xff] += 1;
+        }
+    }
+    for(int d = 0; d < 8; ++d) {
+        auto& c = counts[d];
+        if(c[(keys[0] >> (8 * d)) & 0xff] == n) {
+            continue;
+        }
+        auto offset = std::size_t(0);
+        for(auto& count : c) {
+            auto next = offset + count;
+            count = offset;
+            offset = next;
+        }
+        for(std::size_t i = 0; i < n; ++i) {
+            auto o = c[(keys[i] >> (8 * d)) & 0xff]++;
+            key_scratch[o] = keys[i];
+            value_scratch[o] = values[i];
+        }
+        keys.swap(key_scratch);
+        values.swap(value_scratch);
+    }
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "common/filesystem/mapped_file.hpp"
+#include "common/filesystem/write_file.hpp"
+#include "common/hash/hash.hpp"
+#include "common/image/block_compression.hpp"
+#include "common/image/decode.hpp"
+#include "common/image/mip_chain.hpp"
+#include "common/thread/thread_pool.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+
+// Block compressed mip chains of source images, cooked once and then
+// loaded as is. Each file holds one texture and is named after the hash of
+// its source, so editing a source leaves the stale entry unused.
+
+namespace texture_cache {
+
+// Bump whenever the layout of the file or the encoders change.
+inline constexpr std::uint32_t version = 2;
+
+inline constexpr auto magic = std::array<char, 8>{
+    'L', 'T', 'T', 'E', 'X', 'B', 'C', '\0'};
+
+inline constexpr std::uint64_t alignment = 16;
+
+struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    image::BlockFormat format;
+    std::uint64_t source_hash;
+    std::uint64_t file_size;
+
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t level_count;
+
+    std::uint64_t levels;
+};
+
+// Largest first.
+struct LevelRecord {
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+inline
+std::uint64_t source_hash(std::span<const std::byte> source) {
+    return hash::bytes(source);
+}
+
+inline
+std::filesystem::path path(
+    const std::filesystem::path& directory,
+    std::uint64_t source_hash)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tex",
+        static_cast<unsigned long long>(source_hash));
+    return directory / name;
+}
+
+// Decodes 'source', builds its mip chain and compresses every level, with
+// the block rows of each level spread over 'pool' if any.
+// 'format' defaults to 'image::color_block_format' of the base level, BC3
+// for alpha without 'has_bc7'.
+// Must not be called from a task of 'pool'.
+inline
+std::vector<std::byte> cook(
+    std::span<const std::byte> source,
+    std::optional<image::BlockFormat> format = std::nullopt,
+    ThreadPool* pool = nullptr,
+    bool has_bc7 = true)
+{
+    auto levels = image::mip_chain(image::decode(source));
+    auto& base = levels.front();
+    auto f = format.value_or(image::color_block_format(base, has_bc7));
+
+    auto offset = std::uint64_t(0);
+    auto align = [&]() {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        return offset;
+    };
+    auto header = Header{
+        .magic = magic,
+        .version = version,
+        .format = f,
+        .source_hash = source_hash(source),
+        .file_size = 0,
+        .width = std::uint32_t(base.width),
+        .height = std::uint32_t(base.height),
+        .level_count = std::uint32_t(size(levels)),
+        .levels = 0,
+    };
+    offset += sizeof(Header);
+    header.levels = align();
+    offset += size(levels) * sizeof(LevelRecord);
+    auto records = std::vector<LevelRecord>();
+    for(auto& l : levels) {
+        auto& r = records.emplace_back();
+        r.width = std::uint32_t(l.width);
+        r.height = std::uint32_t(l.height);
+        r.size = std::uint64_t(image::block_count(l.width))
+            * std::uint64_t(image::block_count(l.height))
+            * image::block_bytes(f);
+        r.offset = align();
+        offset += r.size;
+    }
+    header.file_size = align();
+
+    auto bytes = std::vector<std::byte>(header.file_size);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + header.levels,
+        records.data(), size(records) * sizeof(LevelRecord));
+    for(std::size_t li = 0; li < size(levels); ++li) {
+        auto compressed = image::block_image(levels[li].width, levels[li].height, f);
+        auto rows = image::block_count(levels[li].height);
+        if(pool != nullptr and rows > 1) {
+            pool->parallel_for(std::size_t(rows), [&](std::size_t row) {
+                image::compress_rows(levels[li], compressed, int(row), int(row) + 1);
+            });
+        } else {
+            image::compress_rows(levels[li], compressed, 0, rows);
+        }
+        std::memcpy(bytes.data() + records[li].offset,
+            compressed.blocks.data(), size(compressed.blocks));
+    }
+    return bytes;
+}
+
+inline
+void write(
+    const std::filesystem::path& path,
+    std::span<const std::byte> bytes)
+{
+    filesystem::write_file(path, bytes);
+}
+
+class Reader {
+    std::variant<filesystem::MappedFile, std::vector<std::byte>> storage;
+    std::span<const std::byte> bytes;
+
+    // Checks every offset once so that accessors can trust them.
+    bool is_valid(std::uint64_t expected_source_hash) const noexcept {
+        if(size(bytes) < sizeof(Header)) {
+            return false;
+        }
+        auto& h = header();
+        if(h.magic != magic
+            or h.version != version
+            or h.source_hash != expected_source_hash
+            or h.file_size != size(bytes)
+            or std::uint32_t(h.format) >= image::block_format_count
+            or h.level_count == 0
+            or h.levels % alignof(LevelRecord) != 0
+            or h.levels > size(bytes)
+            or h.level_count > (size(bytes) - h.levels) / sizeof(LevelRecord))
+        {
+            return false;
+        }
+        auto width = h.width;
+        auto height = h.height;
+        for(auto& l : levels()) {
+            auto expected_size = std::uint64_t(image::block_count(int(l.width)))
+                * std::uint64_t(image::block_count(int(l.height)))
+                * image::block_bytes(h.format);
+            if(l.width != width
+                or l.height != height
+                or l.size != expected_size
+                or l.offset > size(bytes)
+                or l.size > size(bytes) - l.offset)
+            {
+                return false;
+            }
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        return true;
+    }
+
+    template<typename Storage>
+    static std::optional<Reader> make(Storage&& storage, std::uint64_t source_hash) {
+        auto r = std::optional<Reader>(std::in_place);
+        r->storage = std::forward<Storage>(storage);
+        r->bytes = std::visit([](auto& s) {
+            return std::span<const std::byte>(s.data(), s.size());
+        }, r->storage);
+        if(not r->is_valid(source_hash)) {
+            return std::nullopt;
+        }
+        return r;
+    }
+
+public:
+    // Empty if the file is missing, corrupted or stale.
+    static std::optional<Reader> open(
+        const std::filesystem::path& path,
+        std::uint64_t source_hash)
+    {
+        if(not std::filesystem::is_regular_file(path)) {
+            return std::nullopt;
+        }
+        return make(filesystem::MappedFile(path), source_hash);
+    }
+
+    static std::optional<Reader> from_bytes(
+        std::vector<std::byte> bytes,
+        std::uint64_t source_hash)
+    {
+        return make(std::move(bytes), source_hash);
+    }
+
+    const Header& header() const noexcept {
+        return *reinterpret_cast<const Header*>(bytes.data());
+    }
+
+    std::span<const LevelRecord> levels() const noexcept {
+        return {reinterpret_cast<const LevelRecord*>(bytes.data() + header().levels),
+            header().level_count};
+    }
+
+    std::span<const std::byte> blocks(const LevelRecord& l) const noexcept {
+        return bytes.subspan(l.offset, l.size);
+    }
+
+    // All levels.
+    std::uint64_t block_size() const noexcept {
+        auto s = std::uint64_t(0);
+        for(auto& l : levels()) {
+            s += l.size;
+        }
+        return s;
+    }
+};
+
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include "triple_buffer.hpp"
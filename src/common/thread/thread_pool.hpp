@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::function<void()>> tasks;
+    bool is_stopping = false;
+
+    std::vector<std::thread> workers;
+
+    void work() {
+        while(true) {
+            auto task = std::function<void()>();
+            {
+                auto lock = std::unique_lock(mutex);
+                condition.wait(lock, [&]() {
+                    return is_stopping or not tasks.empty();
+                });
+                if(tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    // Leaves one core to the calling thread, which takes part in 'parallel_for'.
+    explicit
+    ThreadPool(std::size_t thread_count
+        = std::max(std::thread::hardware_concurrency(), 2u) - 1)
+    {
+        workers.reserve(thread_count);
+        for(std::size_t i = 0; i < thread_count; ++i) {
+            workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            auto lock = std::lock_guard(mutex);
+            is_stopping = true;
+        }
+        condition.notify_all();
+        for(auto& w : workers) {
+            w.join();
+        }
+    }
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const noexcept {
+        return workers.size();
+    }
+
+    template<typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<F>> {
+        using Result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(
+            std::forward<F>(f));
+        auto future = task->get_future();
+        {
+            auto lock = std::lock_guard(mutex);
+            tasks.emplace_back([task]() { (*task)(); });
+        }
+        condition.notify_one();
+        return future;
+    }
+
+    // Calls 'f(i)' for every 'i' in [0, count), blocks until all calls returned.
+    // Indices are handed out one at a time, so uneven work balances itself.
+    // The first exception thrown by 'f' is rethrown on the calling thread.
+    // Must not be called from a task of the same pool.
+    template<typename F>
+    void parallel_for(std::size_t count, F&& f) {
+        auto next = std::atomic<std::size_t>(0);
+        auto error = std::exception_ptr();
+        auto error_mutex = std::mutex();
+        auto run = [&]() {
+            for(auto i = next++; i < count; i = next++) {
+                try {
+                    f(i);
+                } catch(...) {
+                    auto lock = std::lock_guard(error_mutex);
+                    if(not error) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+        };
+        auto helper_count = std::min(size(), count > 0 ? count - 1 : 0);
+        auto done = std::latch(std::ptrdiff_t(helper_count));
+        {
+            auto lock = std::lock_guard(mutex);
+            for(std::size_t i = 0; i < helper_count; ++i) {
+                tasks.emplace_back([&]() {
+                    run();
+                    done.count_down();
+                });
+            }
+        }
+        condition.notify_all();
+        run();
+        done.wait();
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
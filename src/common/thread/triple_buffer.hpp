@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one producer thread to one consumer thread without locks
+// or waits. The producer fills its back slot and publishes it, the consumer
+// takes the latest published value, the ones published in between are
+// skipped. A slot is only ever touched by one side, so values are written
+// and read in place.
+template<typename T>
+class TripleBuffer {
+    static constexpr std::uint32_t index_mask = 3;
+    // On the middle slot while published and not yet taken.
+    static constexpr std::uint32_t fresh_bit = 4;
+
+    std::array<T, 3> slots = {};
+    // Slot exchanged between both sides.
+    std::atomic<std::uint32_t> middle = 1;
+    // Producer side.
+    std::uint32_t back = 0;
+    // Consumer side.
+    std::uint32_t front = 2;
+
+public:
+    // Producer. Holds whatever was published two times ago, if anything,
+    // so every field must be written before 'publish'.
+    T& back_slot() {
+        return slots[back];
+    }
+
+    // Producer.
+    void publish() {
+        back = middle.exchange(back | fresh_bit, std::memory_order_acq_rel)
+            & index_mask;
+    }
+
+    // Consumer. Takes the latest published value, if newer than 'front_slot'.
+    bool acquire() {
+        if((middle.load(std::memory_order_relaxed) & fresh_bit) == 0) {
+            return false;
+        }
+        // The producer may publish in between, the value taken is then
+        // only newer.
+        front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    // Consumer.
+    const T& front_slot() const {
+        return slots[front];
+    }
+};
@@ -2,43 +2,239 @@
 
 #include "clock.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <exception>
 #include <functional>
 #include <thread>
 
+inline constexpr std::size_t frame_stats_capacity = 256;
+
+// Intervals between the starts of the last renders.
+struct FrameStats {
+    std::array<float, frame_stats_capacity> intervals = {};
+    std::size_t count = 0;
+    std::size_t next = 0;
+
+    // Renders started after their deadline, since 'run'.
+    std::size_t missed_count = 0;
+    // Updates dropped by the catch-up cap, since 'run'.
+    std::size_t dropped_update_count = 0;
+};
+
+inline
+void push(FrameStats& fs, float interval) {
+    fs.intervals[fs.next] = interval;
+    fs.next = (fs.next + 1) % frame_stats_capacity;
+    fs.count = std::min(fs.count + 1, frame_stats_capacity);
+}
+
+inline
+float mean(const FrameStats& fs) {
+    auto sum = 0.f;
+    for(std::size_t i = 0; i < fs.count; ++i) {
+        sum += fs.intervals[i];
+    }
+    return (fs.count > 0) ? sum / float(fs.count) : 0.f;
+}
+
+// 'p' in [0, 1].
+inline
+float percentile(const FrameStats& fs, float p) {
+    if(fs.count == 0) {
+        return 0.f;
+    }
+    auto sorted = fs.intervals;
+    auto last = begin(sorted) + std::ptrdiff_t(fs.count);
+    auto nth = begin(sorted) + std::ptrdiff_t(
+        std::min(std::size_t(p * float(fs.count)), fs.count - 1));
+    std::nth_element(begin(sorted), nth, last);
+    return *nth;
+}
+
+// Updates run at a fixed rate, several in a row to catch up after a slow
+// frame, renders are paced to their own rate. Between renders the thread
+// sleeps, then spins only for the last 'spin_time' to hit the deadline
+// despite the sleep granularity of the OS.
+// With 'is_update_threaded', updates run on their own thread, paced the same
+// way, so neither delays the other. Everything else stays on the calling
+// thread, which owns the window and the context.
 struct Scheduler {
     std::function<bool()> is_running = [](){ return true; };
 
     std::function<void()> on_init = [](){};
 
+    // Before each render, on the calling thread, to poll window events.
+    std::function<void()> on_input = [](){};
+
     float time_per_render = 1.f / 60.f;
-    float time_since_render = 0.f;
-    std::function<void()> on_render = [](){};
+    // Given how far the simulation is between the last update and the next
+    // one, in [0, 1), to interpolate what it draws.
+    std::function<void(float)> on_render = [](float){};
 
     float time_per_update = 1.f / 60.f;
-    float time_since_update = 0.f;
     std::function<void()> on_update = [](){};
+    // Per render, the backlog beyond is dropped so that updates slower than
+    // real time cannot fall further and further behind.
+    int max_updates_per_render = 5;
+    // Then 'on_update' may only share state with the rest through thread
+    // safe handoffs, see 'TripleBuffer'.
+    bool is_update_threaded = false;
+
+    float spin_time = 0.002f;
+
+    FrameStats stats;
 };
 
+inline
+std::chrono::steady_clock::duration period(float seconds) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<float>(seconds));
+}
+
+// Sleeps, then spins, until 'deadline'.
+inline
+void wait_until(
+    std::chrono::steady_clock::time_point deadline,
+    float spin_time)
+{
+    auto spin = period(spin_time);
+    auto now = std::chrono::steady_clock::now();
+    if(deadline - now > spin) {
+        std::this_thread::sleep_for(deadline - now - spin);
+    }
+    while(std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+// Renders on the calling thread at 'time_per_render'.
+struct RenderPacing {
+    Clock clock;
+    std::chrono::steady_clock::time_point next_render
+        = std::chrono::steady_clock::now();
+    bool is_first_render = true;
+};
+
+// Renders then waits for the next deadline.
+inline
+void paced_render(Scheduler& s, RenderPacing& p, float alpha) {
+    { // Render.
+        auto interval = p.clock.restart().count();
+        if(not p.is_first_render) {
+            push(s.stats, interval);
+        }
+        p.is_first_render = false;
+        s.on_input();
+        s.on_render(alpha);
+    }
+    { // Pacing.
+        p.next_render += period(s.time_per_render);
+        auto now = std::chrono::steady_clock::now();
+        if(now > p.next_render) {
+            // Late, the missed renders are skipped rather than rushed.
+            s.stats.missed_count += 1;
+            p.next_render = now;
+        } else {
+            wait_until(p.next_render, s.spin_time);
+        }
+    }
+}
+
+inline
+void run_threaded(Scheduler& s) {
+    using std::chrono::steady_clock;
+    auto update_period = period(s.time_per_update);
+    // Beyond, the backlog is dropped as when not threaded.
+    auto max_lateness = update_period * s.max_updates_per_render;
+
+    s.on_init();
+
+    auto last_update = std::atomic<steady_clock::rep>(
+        steady_clock::now().time_since_epoch().count());
+    auto dropped_update_count = std::atomic<std::size_t>(0);
+    // Thrown by 'on_update', rethrown here once joined as 'run' would.
+    auto update_exception = std::exception_ptr();
+    auto has_update_failed = std::atomic<bool>(false);
+    // Stopped and joined when leaving, even by an exception.
+    auto update_thread = std::jthread([&](std::stop_token stop) {
+        try {
+            auto next_update = steady_clock::now();
+            while(not stop.stop_requested()) {
+                s.on_update();
+                last_update.store(steady_clock::now().time_since_epoch().count(),
+                    std::memory_order_relaxed);
+                next_update += update_period;
+                auto now = steady_clock::now();
+                if(now - next_update > max_lateness) {
+                    dropped_update_count.fetch_add(
+                        std::size_t((now - next_update) / update_period),
+                        std::memory_order_relaxed);
+                    next_update = now;
+                } else {
+                    // Returns at once while catching up.
+                    wait_until(next_update, s.spin_time);
+                }
+            }
+        } catch(...) {
+            update_exception = std::current_exception();
+            has_update_failed.store(true, std::memory_order_relaxed);
+        }
+    });
+
+    auto p = RenderPacing();
+    while(s.is_running()
+        and not has_update_failed.load(std::memory_order_relaxed))
+    {
+        s.stats.dropped_update_count = dropped_update_count.load(
+            std::memory_order_relaxed);
+        auto since_update = steady_clock::now().time_since_epoch()
+            - steady_clock::duration(last_update.load(std::memory_order_relaxed));
+        auto alpha = std::chrono::duration<float>(since_update).count()
+            / s.time_per_update;
+        paced_render(s, p, std::clamp(alpha, 0.f, 0.999f));
+    }
+
+    update_thread.request_stop();
+    update_thread.join();
+    if(update_exception) {
+        std::rethrow_exception(update_exception);
+    }
+}
+
 inline
 void run(Scheduler& s) {
-    auto c = Clock();
+    if(s.is_update_threaded) {
+        run_threaded(s);
+        return;
+    }
+
     s.on_init();
+
+    auto c = Clock();
+    auto time_since_update = 0.f;
+    auto p = RenderPacing();
     while(s.is_running()) {
-        {
-            auto time_elapsed = c.restart().count();
-            s.time_since_render += time_elapsed;
-            s.time_since_update += time_elapsed;
-        }
-        if(s.time_since_update >= s.time_per_update) {
-            s.time_since_update -= s.time_per_update;
-            s.on_update();
-        }
-        if(s.time_since_render >= s.time_per_render) {
-            // Skip accumulated renders.
-            s.time_since_render = std::fmod(s.time_since_render, s.time_per_render);
-            s.on_render();
+        { // Updates.
+            time_since_update += c.restart().count();
+            auto update_count = 0;
+            while(time_since_update >= s.time_per_update
+                and update_count < s.max_updates_per_render)
+            {
+                time_since_update -= s.time_per_update;
+                s.on_update();
+                update_count += 1;
+            }
+            if(time_since_update >= s.time_per_update) {
+                s.stats.dropped_update_count += std::size_t(
+                    time_since_update / s.time_per_update);
+                time_since_update = std::fmod(time_since_update, s.time_per_update);
+            }
         }
-        std::this_thread::sleep_for(std::chrono::seconds(0));
+        paced_render(s, p, time_since_update / s.time_per_update);
     }
 }
@@ -0,0 +1,447 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TRANSFORM_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(TRANSFORM_X64) && (defined(__GNUC__) || defined(__clang__))
+#define TRANSFORM_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define TRANSFORM_TARGET_AVX2
+#endif
+
+// Batched 4x4 matrix products on column major float arrays.
+// Matrices are 16 floats, affine matrices are 12 floats: the first three
+// rows of the four columns of a 4x4 matrix whose last row is (0, 0, 0, 1).
+namespace transform {
+
+inline constexpr std::uint32_t no_parent
+= std::numeric_limits<std::uint32_t>::max();
+
+enum class Isa {
+    scalar,
+    sse,
+    avx2,
+};
+
+inline constexpr std::size_t isa_count = 3;
+
+inline constexpr const char* isa_names[isa_count] = {
+    "Scalar",
+    "SSE",
+    "AVX2",
+};
+
+struct Kernels {
+    // 'out[i] = a * b[i]'.
+    void (*multiply)(
+        const float* a,
+        const float* b,
+        float* out,
+        std::size_t count);
+    // 'worlds[i] = worlds[parents[i]] * locals[i]' for every dirty node
+    // and its descendants, parents must precede their children.
+    // Dirty flags are propagated, not cleared. Returns the updated count.
+    std::size_t (*propagate)(
+        const std::uint32_t* parents,
+        const float* locals,
+        std::uint8_t* dirty,
+        float* worlds,
+        std::size_t count);
+    // Same with affine 'locals'.
+    std::size_t (*propagate_affine)(
+        const std::uint32_t* parents,
+        const float* locals,
+        std::uint8_t* dirty,
+        float* worlds,
+        std::size_t count);
+};
+
+namespace scalar {
+
+inline
+void multiply4(const float* a, const float* b, float* out) {
+    for(int c = 0; c < 4; ++c) {
+        for(int r = 0; r < 4; ++r) {
+            out[4 * c + r]
+            = a[r] * b[4 * c]
+            + a[4 + r] * b[4 * c + 1]
+            + a[8 + r] * b[4 * c + 2]
+            + a[12 + r] * b[4 * c + 3];
+        }
+    }
+}
+
+inline
+void multiply_affine(const float* a, const float* b, float* out) {
+    for(int c = 0; c < 4; ++c) {
+        for(int r = 0; r < 4; ++r) {
+            out[4 * c + r]
+            = a[r] * b[3 * c]
+            + a[4 + r] * b[3 * c + 1]
+            + a[8 + r] * b[3 * c + 2]
+            + (c == 3 ? a[12 + r] : 0.f);
+        }
+    }
+}
+
+// From affine to 4x4.
+inline
+void expand_affine(const float* a, float* out) {
+    for(int c = 0; c < 4; ++c) {
+        out[4 * c] = a[3 * c];
+        out[4 * c + 1] = a[3 * c + 1];
+        out[4 * c + 2] = a[3 * c + 2];
+        out[4 * c + 3] = (c == 3) ? 1.f : 0.f;
+    }
+}
+
+inline
+void multiply(const float* a, const float* b, float* out, std::size_t count) {
+    for(std::size_t i = 0; i < count; ++i) {
+        multiply4(a, b + 16 * i, out + 16 * i);
+    }
+}
+
+// 'Local' is 16 or 12 floats, 'f' writes a world matrix.
+template<std::size_t Local, typename F>
+std::size_t propagate(
+    const std::uint32_t* parents,
+    const float* locals,
+    std::uint8_t* dirty,
+    float* worlds,
+    std::size_t count,
+    F f)
+{
+    auto updated = std::size_t(0);
+    for(std::size_t i = 0; i < count; ++i) {
+        auto parent = parents[i];
+        if(parent != no_parent and dirty[parent]) {
+            dirty[i] = 1;
+        }
+        if(dirty[i]) {
+            f(parent, locals + Local * i, worlds + 16 * i);
+            updated += 1;
+        }
+    }
+    return updated;
+}
+
+inline
+std::size_t propagate(
+    const std::uint32_t* parents,
+    const float* locals,
+    std::uint8_t* dirty,
+    float* worlds,
+    std::size_t count)
+{
+    return propagate<16>(parents, locals, dirty, worlds, count,
+        [&](std::uint32_t parent, const float* local, float* world) {
+            if(parent == no_parent) {
+                for(int k = 0; k < 16; ++k) {
+                    world[k] = local[k];
+                }
+            } else {
+                multiply4(worlds + 16 * parent, local, world);
+            }
+        });
+}
+
+inline
+std::size_t propagate_affine(
+    const std::uint32_t* parents,
+    const float* locals,
+    std::uint8_t* dirty,
+    float* worlds,
+    std::size_t count)
+{
+    return propagate<12>(parents, locals, dirty, worlds, count,
+        [&](std::uint32_t parent, const float* local, float* world) {
+            if(parent == no_parent) {
+                expand_affine(local, world);
+            } else {
+                multiply_affine(worlds + 16 * parent, local, world);
+            }
+        });
+}
+
+}
+
+#ifdef TRANSFORM_X64
+
+namespace sse {
+
+inline
+void multiply4(const float* a, const float* b, float* out) {
+    auto a0 = _mm_loadu_ps(a);
+    auto a1 = _mm_loadu_ps(a + 4);
+    auto a2 = _mm_loadu_ps(a + 8);
+    auto a3 = _mm_loadu_ps(a + 12);
+    for(int c = 0; c < 4; ++c) {
+        auto r = _mm_mul_ps(a0, _mm_set1_ps(b[4 * c]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[4 * c + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[4 * c + 2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[4 * c + 3])));
+        _mm_storeu_ps(out + 4 * c, r);
+    }
+}
+
+inline
+void multiply_affine(const float* a, const float* b, float* out) {
+    auto a0 = _mm_loadu_ps(a);
+    auto a1 = _mm_loadu_ps(a + 4);
+    auto a2 = _mm_loadu_ps(a + 8);
+    auto a3 = _mm_loadu_ps(a + 12);
+    for(int c = 0; c < 4; ++c) {
+        auto r = _mm_mul_ps(a0, _mm_set1_ps(b[3 * c]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[3 * c + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[3 * c + 2])));
+        _mm_storeu_ps(out + 4 * c, r);
+    }
+    _mm_storeu_ps(out + 12, _mm_add_ps(_mm_loadu_ps(out + 12), a3));
+}
+
+inline
+void multiply(const float* a, const float* b, float* out, std::size_t count) {
+    auto a0 = _mm_loadu_ps(a);
+    auto a1 = _mm_loadu_ps(a + 4);
+    auto a2 = _mm_loadu_ps(a + 8);
+    auto a3 = _mm_loadu_ps(a + 12);
+    for(std::size_t i = 0; i < 16 * count; i += 4) {
+        auto r = _mm_mul_ps(a0, _mm_set1_ps(b[i]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[i + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[i + 2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[i + 3])));
+        _mm_storeu_ps(out + i, r);
+    }
+}
+
+inline
+std::size_t propagate(
+    const std::uint32_t* parents,
+    const float* locals,
+    std::uint8_t* dirty,
+    float* worlds,
+    std::size_t count)
+{
+    return scalar::propagate<16>(parents, locals, dirty, worlds, count,
+        [&](std::uint32_t parent, const float* local, float* world) {
+            if(parent == no_parent) {
+                for(int k = 0; k < 16; k += 4) {
+                    _mm_storeu_ps(world + k, _mm_loadu_ps(local + k));
+                }
+            } else {
+                multiply4(worlds + 16 * parent, local, world);
+            }
+        });
+}
+
+inline
+std::size_t propagate_affine(
+    const std::uint32_t* parents,
+    const float* locals,
+    std::uint8_t* dirty,
+    float* worlds,
+    std::size_t count)
+{
+    return scalar::propagate<12>(parents, locals, dirty, worlds, count,
+        [&](std::uint32_t parent, const float* local, float* world) {
+            if(parent == no_parent) {
+                scalar::expand_affine(local, world);
+            } else {
+                multiply_affine(worlds + 16 * parent, local, world);
+            }
+        });
+}
+
+}
+
+// Two columns per 256 bit register, fused multiply-add.
+namespace avx2 {
+
+TRANSFORM_TARGET_AVX2 inline
+void multiply4(
+    __m256 a0, __m256 a1, __m256 a2, __m256 a3,
+    const float* b,
+    float* out)
+{
+    for(int c = 0; c < 16; c += 8) {
+        auto bc = _mm256_loadu_ps(b + c);
+        auto r = _mm256_mul_ps(a0, _mm256_permute_ps(bc, 0x00));
+        r = _mm256_fmadd_ps(a1, _mm256_permute_ps(bc, 0x55), r);
+        r = _mm256_fmadd_ps(a2, _mm256_permute_ps(bc, 0xaa), r);
+        r = _mm256_fmadd_ps(a3, _mm256_permute_ps(bc, 0xff), r);
+        _mm256_storeu_ps(out + c, r);
+    }
+}
+
+TRANSFORM_TARGET_AVX2 inline
+void multiply4(const float* a, const float* b, float* out) {
+    multiply4(
+        _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a)),
+        _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4)),
+        _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8)),
+        _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12)),
+        b, out);
+}
+
+TRANSFORM_TARGET_AVX2 inline
+void multiply_affine(const float* a, const float* b, float* out) {
+    auto a0 = _mm_loadu_ps(a);
+    auto a1 = _mm_loadu_ps(a + 4);
+    auto a2 = _mm_loadu_ps(a + 8);
+    auto a3 = _mm_loadu_ps(a + 12);
+    for(int c = 0; c < 3; ++c) {
+        auto r = _mm_mul_ps(a0, _mm_broadcast_ss(b + 3 * c));
+        r = _mm_fmadd_ps(a1, _mm_broadcast_ss(b + 3 * c + 1), r);
+        r = _mm_fmadd_ps(a2, _mm_broadcast_ss(b + 3 * c + 2), r);
+        _mm_storeu_ps(out + 4 * c, r);
+    }
+    auto r = _mm_fmadd_ps(a0, _mm_broadcast_ss(b + 9), a3);
+    r = _mm_fmadd_ps(a1, _mm_broadcast_ss(b + 10), r);
+    r = _mm_fmadd_ps(a2, _mm_broadcast_ss(b + 11), r);
+    _mm_storeu_ps(out + 12, r);
+}
+
+TRANSFORM_TARGET_AVX2 inline
+void multiply(const float* a, const float* b, float* out, std::size_t count) {
+    auto a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+    auto a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+    auto a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+    auto a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+    for(std::size_t i = 0; i < count; ++i) {
+        multiply4(a0, a1, a2, a3, b + 16 * i, out + 16 * i);
+    }
+}
+
+// Lambdas do not inherit the target, hence the explicit loops.
+TRANSFORM_TARGET_AVX2 inline
+std::size_t propagate(
+    const std::uint32_t* parents,
+    const float* locals,
+    std::uint8_t* dirty,
+    float* worlds,
+    std::size_t count)
+{
+    auto updated = std::size_t(0);
+    for(std::size_t i = 0; i < count; ++i) {
+        auto parent = parents[i];
+        if(parent != no_parent and dirty[parent]) {
+            dirty[i] = 1;
+        }
+        if(dirty[i]) {
+            if(parent == no_parent) {
+                _mm256_storeu_ps(worlds + 16 * i, _mm256_loadu_ps(locals + 16 * i));
+                _mm256_storeu_ps(worlds + 16 * i + 8, _mm256_loadu_ps(locals + 16 * i + 8));
+            } else {
+                multiply4(worlds + 16 * parent, locals + 16 * i, worlds + 16 * i);
+            }
+            updated += 1;
+        }
+    }
+    return updated;
+}
+
+TRANSFORM_TARGET_AVX2 inline
+std::size_t propagate_affine(
+    const std::uint32_t* parents,
+    const float* locals,
+    std::uint8_t* dirty,
+    float* worlds,
+    std::size_t count)
+{
+    auto updated = std::size_t(0);
+    for(std::size_t i = 0; i < count; ++i) {
+        auto parent = parents[i];
+        if(parent != no_parent and dirty[parent]) {
+            dirty[i] = 1;
+        }
+        if(dirty[i]) {
+            if(parent == no_parent) {
+                scalar::expand_affine(locals + 12 * i, worlds + 16 * i);
+            } else {
+                multiply_affine(worlds + 16 * parent, locals + 12 * i, worlds + 16 * i);
+            }
+            updated += 1;
+        }
+    }
+    return updated;
+}
+
+}
+
+#endif
+
+inline
+bool is_supported(Isa isa) {
+    switch(isa) {
+    case Isa::scalar:
+        return true;
+#ifdef TRANSFORM_X64
+    case Isa::sse:
+        return true;
+    case Isa::avx2: {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if(info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        auto fma = (info[2] & (1 << 12)) != 0;
+        auto osxsave = (info[2] & (1 << 27)) != 0;
+        if(not fma or not osxsave or (_xgetbv(0) & 6) != 6) {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma");
+#endif
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+// Most capable instruction set of this CPU.
+inline
+Isa best_isa() {
+    static const auto isa
+    = is_supported(Isa::avx2) ? Isa::avx2
+    : is_supported(Isa::sse) ? Isa::sse
+    : Isa::scalar;
+    return isa;
+}
+
+// 'isa' must be supported.
+inline
+const Kernels& kernels(Isa isa) {
+    static const Kernels table[isa_count] = {
+        {scalar::multiply, scalar::propagate, scalar::propagate_affine},
+#ifdef TRANSFORM_X64
+        {sse::multiply, sse::propagate, sse::propagate_affine},
+        {avx2::multiply, avx2::propagate, avx2::propagate_affine},
+#else
+        {scalar::multiply, scalar::propagate, scalar::propagate_affine},
+        {scalar::multiply, scalar::propagate, scalar::propagate_affine},
+#endif
+    };
+    return table[std::size_t(isa)];
+}
+
+inline
+const Kernels& kernels() {
+    return kernels(best_isa());
+}
+
+}
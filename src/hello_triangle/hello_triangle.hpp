@@ -2,13 +2,73 @@
 
 #include "common/dependency/abstractgl_api_opengl.hpp"
 #include "common/dependency/glm.hpp"
+#include "common/opengl/command_list.hpp"
 #include "common/opengl/debug_message_callback.hpp"
+#include "common/opengl/vertex_layout.hpp"
 #include "common/all.hpp"
 
 #include <agl/standard/all.hpp>
 
+#include <array>
+
+// Of 'common/glsl/shader/test.vert'.
+inline constexpr auto test_inputs = std::array<glsl::ShaderInput, 2>{{
+    {"a_normal", 0, 3},
+    {"a_position", 1, 3},
+}};
+
+// Positions only, the test shader does not read normals.
+inline constexpr auto solid_box_layout = VertexLayout<1>{
+    .attributes = {{
+        {"a_position", 1, GL_FLOAT, 3, false, 0},
+    }},
+    .strides = {GLsizei(sizeof(glm::vec3))},
+};
+
+// Unit sphere, positions are also its normals.
+inline constexpr auto solid_uv_sphere_layout = VertexLayout<1>{
+    .attributes = {{
+        {"a_position", 1, GL_FLOAT, 3, false, 0},
+    }},
+    .strides = {GLsizei(sizeof(glm::vec3))},
+};
+
+static_assert(is_valid(solid_box_layout)
+    and matches(solid_box_layout, test_inputs));
+static_assert(is_valid(solid_uv_sphere_layout)
+    and matches(solid_uv_sphere_layout, test_inputs));
+
+inline
+gl::VertexArrayObj vertex_array(const gizmo::SolidBox& sb) {
+    auto va = gl::VertexArrayObj();
+    set_layout(va, solid_box_layout);
+    gl::VertexArrayVertexBuffer(va,
+        0,
+        sb.position_buffer,
+        0, solid_box_layout.strides[0]);
+    gl::VertexArrayElementBuffer(va,
+        sb.element_buffer);
+    return va;
+}
+
+inline
+gl::VertexArrayObj vertex_array(const gizmo::Solid_UV_Sphere& suvs) {
+    auto va = gl::VertexArrayObj();
+    set_layout(va, solid_uv_sphere_layout);
+    gl::VertexArrayVertexBuffer(va,
+        0,
+        suvs.normals_positions,
+        0, solid_uv_sphere_layout.strides[0]);
+    gl::VertexArrayElementBuffer(va,
+        suvs.elements);
+    return va;
+}
+
 struct HelloTriangle {
-    WireframeRenderer wireframe_renderer = ::wireframe_renderer();
+    // Fills the programs below in place.
+    glsl::ShaderManager shader_manager;
+
+    WireframeRenderer wireframe_renderer;
 
     WireAxes wire_axes;
     gl::VertexArrayObj wire_axes_wireframe_renderer_vao;
@@ -28,34 +88,36 @@ struct HelloTriangle {
     glm::mat4 world_to_view = glm::mat4(1.f);
     glm::vec2 yaw_pitch = glm::vec2(0.f, 0.f);
     glm::vec3 camera_position = glm::vec3(0.f);
+
+    // Recorded by 'render' every frame, keeps its allocation.
+    CommandList commands;
 };
 
 void init(HelloTriangle& _this) {
     std::ignore = _this;
+    { // Programs, compiled in parallel.
+        _this.shader_manager = glsl::shader_manager();
+        submit(_this.shader_manager, _this.wireframe_renderer);
+        auto stages = std::array<glsl::ShaderStage, 2>{
+            glsl::ShaderStage{GL_VERTEX_SHADER,
+                glsl::with_inputs(agl::standard::string(filesystem::recursive_parent_path(
+                    "src/common/glsl/shader/test.vert")),
+                    test_inputs)},
+            glsl::ShaderStage{GL_FRAGMENT_SHADER,
+                agl::standard::string(filesystem::recursive_parent_path(
+                    "src/common/glsl/shader/test.frag"))},
+        };
+        glsl::submit(_this.shader_manager, _this.shader_program, stages, [&_this]() {
+            _this.object_to_clip_location = gl::GetUniformLocation(
+                _this.shader_program,
+                "object_to_clip");
+        });
+        // Both are drawn from the first frame.
+        wait(_this.shader_manager);
+    }
     { // VAOs.
         _this.wire_axes_wireframe_renderer_vao
-        = vertex_array(_this.wire_axes, _this.wireframe_renderer);
-    }
-    { // Shader program.
-        auto vertex_shader = gl::VertexShaderObj();
-        gl::ShaderSource(vertex_shader,
-            agl::standard::string(
-                "D:/dev/project/abstractgl-sandbox/src/common/glsl/shader/test.vert"));
-        gl::CompileShader(vertex_shader);
-
-        auto fragment_shader = gl::FragmentShaderObj();
-        gl::ShaderSource(fragment_shader,
-            agl::standard::string(
-                "D:/dev/project/abstractgl-sandbox/src/common/glsl/shader/test.frag"));
-        gl::CompileShader(fragment_shader);
-
-        gl::AttachShader(_this.shader_program, vertex_shader);
-        gl::AttachShader(_this.shader_program, fragment_shader);
-        gl::LinkProgram(_this.shader_program);
-
-        _this.object_to_clip_location = gl::GetUniformLocation(
-            _this.shader_program,
-            "object_to_clip");
+        = vertex_array(_this.wire_axes);
     }
     { // Camera.
         _this.view_to_clip = glm::perspective(
@@ -66,67 +128,10 @@ void init(HelloTriangle& _this) {
     }
     { // Solid box.
         _this.solid_box = gizmo::solid_box();
-        // { // Normal attribute.
-        //     auto attribindex = gl::GetAttribLocation(_this.shader_program, "a_normal");
-        //     auto bindingindex = GLuint(0);
-        //     gl::VertexArrayAttribFormat(_this.solid_box_vao,
-        //         attribindex,
-        //         3, GL_FLOAT,
-        //         GL_FALSE, 0);
-        //     gl::VertexArrayVertexBuffer(_this.solid_box_vao,
-        //         bindingindex,
-        //         _this.solid_box.normal_buffer,
-        //         0, sizeof(glm::vec3));
-        //     gl::VertexArrayAttribBinding(_this.solid_box_vao,
-        //         attribindex,
-        //         bindingindex);
-        //     gl::EnableVertexArrayAttrib(_this.solid_box_vao,
-        //         attribindex);
-        // }
-        { // Position attribute.
-            auto attribindex = gl::GetAttribLocation(_this.shader_program, "a_position");
-            auto bindingindex = GLuint(1);
-            gl::VertexArrayAttribFormat(_this.solid_box_vao,
-                attribindex,
-                3, GL_FLOAT,
-                GL_FALSE, 0);
-            gl::VertexArrayVertexBuffer(_this.solid_box_vao,
-                bindingindex,
-                _this.solid_box.position_buffer,
-                0, sizeof(glm::vec3));
-            gl::VertexArrayAttribBinding(_this.solid_box_vao,
-                attribindex,
-                bindingindex);
-            gl::EnableVertexArrayAttrib(_this.solid_box_vao,
-                attribindex);
-        }
-        { // Element buffer.
-            gl::VertexArrayElementBuffer(_this.solid_box_vao,
-                _this.solid_box.element_buffer);
-        }
+        _this.solid_box_vao = vertex_array(_this.solid_box);
     }
-        { // Solid UV sphere.
-        { // Positions.
-            auto attribindex = gl::GetAttribLocation(_this.shader_program, "a_position");
-            auto bindingindex = GLuint(1);
-            gl::VertexArrayAttribFormat(_this.solid_uv_sphere_vao,
-                attribindex,
-                3, GL_FLOAT,
-                GL_FALSE, 0);
-            gl::VertexArrayVertexBuffer(_this.solid_uv_sphere_vao,
-                bindingindex,
-                _this.solid_uv_sphere.normals_positions,
-                0, sizeof(glm::vec3));
-            gl::VertexArrayAttribBinding(_this.solid_uv_sphere_vao,
-                attribindex,
-                bindingindex);
-            gl::EnableVertexArrayAttrib(_this.solid_uv_sphere_vao,
-                attribindex);
-        }
-        { // Element buffer.
-            gl::VertexArrayElementBuffer(_this.solid_uv_sphere_vao,
-                _this.solid_uv_sphere.elements);
-        }
+    { // Solid UV sphere.
+        _this.solid_uv_sphere_vao = vertex_array(_this.solid_uv_sphere);
     }
 }
 
@@ -170,43 +175,47 @@ void update(HelloTriangle& _this) {
 void render(HelloTriangle& _this) {
     gl::ClearNamedFramebuffer(gl::ZERO, gl::DEPTH, 1.f);
 
-    { // Solid renderer.
-        gl::UseProgram(_this.shader_program);
-        gl::BindVertexArray(_this.solid_uv_sphere_vao);
+    auto& cl = _this.commands;
+    clear(cl);
+
+    glCullFace(GL_BACK);
+    glDepthFunc(GL_LESS);
+    enable(cl, GL_DEPTH_TEST);
 
-        glCullFace(GL_BACK);
-        auto cull_cap = scoped(gl::Enable(GL_CULL_FACE));
+    { // Solid renderer.
+        use_program(cl, _this.shader_program);
+        bind_vertex_array(cl, _this.solid_uv_sphere_vao);
 
-        glDepthFunc(GL_LESS);
-        auto depth_cap = scoped(gl::Enable(GL_DEPTH_TEST));
+        enable(cl, GL_CULL_FACE);
 
-        glProgramUniformMatrix4fv(_this.shader_program,
+        uniform(cl, _this.shader_program,
             _this.object_to_clip_location,
-            1, GL_FALSE,
-            &_this.world_to_clip[0][0]);
+            _this.world_to_clip);
 
-        glDrawElements(
+        draw_elements(cl,
             _this.solid_uv_sphere.mode,
             _this.solid_uv_sphere.count,
             _this.solid_uv_sphere.type,
             0);
+
+        disable(cl, GL_CULL_FACE);
     }
     { // Wireframe renderer.
-        gl::UseProgram(_this.wireframe_renderer.program);
-        
-        gl::BindVertexArray(_this.wire_axes_wireframe_renderer_vao);
+        use_program(cl, _this.wireframe_renderer.program);
 
-        glDepthFunc(GL_LESS);
-        auto depth_cap = scoped(gl::Enable(GL_DEPTH_TEST));
+        bind_vertex_array(cl, _this.wire_axes_wireframe_renderer_vao);
 
-        glProgramUniformMatrix4fv(_this.wireframe_renderer.program,
+        uniform(cl, _this.wireframe_renderer.program,
             _this.wireframe_renderer.object_to_clip,
-            1, GL_FALSE,
-            &_this.world_to_clip[0][0]);
+            _this.world_to_clip);
 
-        glDrawArrays(
+        draw_arrays(cl,
             _this.wire_axes.mode,
             _this.wire_axes.first,
             _this.wire_axes.count);
     }
+
+    disable(cl, GL_DEPTH_TEST);
+
+    execute(cl);
 }
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "common/dependency/glm.hpp"
+
+#include <assimp/matrix4x4.h>
+
+// Assimp matrices are row major.
+inline
+glm::mat4 to_glm(const aiMatrix4x4& m) {
+    return glm::transpose(glm::make_mat4(&m.a1));
+}
@@ -1,13 +1,37 @@
 #pragma once
 
+#include "assimp/conversion.hpp"
 #include "material/material.hpp"
+#include "material/material_table.hpp"
+#include "mesh/geometry_arena.hpp"
 #include "mesh/mesh.hpp"
 #include "mesh/vertex_array.hpp"
+#include "render/frame_data.hpp"
+#include "render/frustum_culling.hpp"
+#include "render/gpu_culling.hpp"
+#include "render/instancing.hpp"
+#include "render/multi_draw.hpp"
+#include "render/object_ring.hpp"
+#include "render/occlusion_culling.hpp"
+#include "render/recorded_draws.hpp"
+#include "render/render_queue.hpp"
+#include "render/render_stats.hpp"
+#include "render/render_target.hpp"
+#include "render/shading.hpp"
+#include "scene_cache/scene_cache.hpp"
 #include "scene_graph/scene_graph.hpp"
+#include "simulation/simulation.hpp"
+#include "texture/texture.hpp"
+#include "texture/texture_arrays.hpp"
+#include "texture/texture_streaming.hpp"
 
 #include "common/dependency/abstractgl_api_opengl.hpp"
 #include "common/dependency/glm.hpp"
+#include "common/glsl/solid_renderer/solid_variants.hpp"
 #include "common/opengl/debug_message_callback.hpp"
+#include "common/thread/thread_pool.hpp"
+#include "common/thread/triple_buffer.hpp"
+#include "common/transform/kernels.hpp"
 #include "common/all.hpp"
 
 #include <agl/standard/all.hpp>
@@ -15,273 +39,413 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <array>
 #include <filesystem>
+#include <iostream>
 #include <optional>
 #include <span>
+#include <thread>
 #include <vector>
 
-struct TextureResource
-{
-	std::filesystem::path file_path;
-
-	std::optional<gl::TextureObject> gpu;
-};
-
 struct LittlestTokyo {
-	float dt = 1.f / 60.f;
-
-	gl::FramebufferObject render_framebuffer;
-
-	glsl::DepthRenderer depth_renderer;
-    glsl::SolidRenderer solid_renderer;
-
+	ThreadPool thread_pool;
+    // Texture decoding, separate so 'parallel_for' never waits behind it.
+    ThreadPool texture_pool = ThreadPool(
+        std::max(std::thread::hardware_concurrency() / 2, 1u));
+
+    // The scene is drawn here, its depth feeds 'gpu_culling'.
+    RenderTarget render_target;
+
+	// Fills the renderers below in place, they must not move.
+	glsl::ProgramCache program_cache;
+	glsl::ShaderManager shader_manager;
+
+    // One program per minimal feature set drawn, see 'Mesh::features'.
+    glsl::SolidVariants solid_variants;
+    Shading shading = Shading::base_color;
+    // Program of each mesh for the recorded draws, 0 until linked.
+    std::vector<GLuint> mesh_programs;
+    // Camera block of the solid renderers.
+    FrameUniforms frame_uniforms;
+    // Object blocks of the solid renderers, written by every CPU path.
+    ObjectRing object_ring;
+
+    // World transforms are those of the latest snapshot.
     SceneGraph scene;
+    std::uint64_t transform_version = 1;
+    // Nodes whose world transform was recomputed by the update of the
+    // latest snapshot, 0 if it was already drawn.
+    std::size_t transform_update_count = 0;
+    FrustumCulling frustum_culling;
+    OcclusionCulling occlusion_culling;
+    glsl::GpuCulling gpu_culling_programs;
+    GpuCulling gpu_culling;
 
 	std::vector<Material> materials;
+    MaterialTable material_table;
     std::vector<Mesh> meshes;
-    std::vector<gl::VertexArrayObj> mesh_solid_renderer_vertex_arrays;
+    GeometryArena geometry;
+    // One vertex array per format, shared with the gizmos.
+    VertexArrayCache vertex_arrays;
+    // All formats stay resident so they can be switched at runtime.
+    std::array<VertexBuffers, vertex_format_count> geometry_buffers;
+    VertexFormat vertex_format = VertexFormat::quantized;
+
+    // Direct submission, one object per mesh instance.
+    std::vector<ObjectData> direct_objects;
+    std::vector<MeshId> direct_meshes;
+    std::vector<float> direct_depths;
+    // Direct draws and gizmos, sorted by state then front to back.
+    RenderQueue render_queue;
+    MultiDraw multi_draw;
+    Instancing instancing;
+    RecordedDraws recorded_draws;
+    RenderMode render_mode = RenderMode::multi_draw_indirect;
+    std::array<RenderStats, render_mode_count> render_stats;
 
 	std::vector<TextureResource> textures;
+    TextureStreaming texture_streaming;
+    TextureArrays texture_arrays;
+
+	// Written after the first import, reused while the scene is unchanged.
+	std::filesystem::path scene_cache_path = "cache/littlest_tokyo.scene";
+	// Block compressed textures, one file per source image.
+	std::filesystem::path texture_cache_directory = "cache/textures";
+	// Linked program binaries, one file per program and driver.
+	std::filesystem::path program_cache_directory = "cache/programs";
 
 	gizmo::triangle::Quad quad;
-	gl::VertexArrayObj quad_solid_renderer;
-	glm::vec3 quad_position = glm::vec3(0.f);
-	float quad_scale = 1.f;
+	VertexBuffers quad_buffers;
 
 	gizmo::Solid_UV_Sphere sphere = gizmo::Solid_UV_Sphere(30, 30);
-	gl::VertexArrayObj sphere_depth_renderer_va;
-	gl::VertexArrayObj sphere_solid_renderer_va;
-	glm::vec3 sphere_position = glm::vec3(0.f);
-	glm::vec3 sphere_scale = glm::vec3(1.f);
-
-    // Camera.
-	float camera_speed = 1.f;
-    glm::mat4 view_to_clip = glm::mat4(1.f);
-    glm::mat4 world_to_clip = glm::mat4(1.f);
-    glm::mat4 world_to_view = glm::mat4(1.f);
-    glm::vec2 yaw_pitch = glm::vec2(0.f, 0.f);
-    glm::vec3 camera_position = glm::vec3(0.f);
+	VertexBuffers sphere_buffers;
+
+    // Main thread, edited by the UI and forwarded by 'forward_input'.
+    InputState input;
+    TripleBuffer<InputState> inputs;
+    // Only touched by 'update', possibly on its own thread, which talks to
+    // the others through 'inputs' and 'snapshots' alone.
+    Simulation simulation;
+    TripleBuffer<Snapshot> snapshots;
 };
 
-void init(LittlestTokyo& _this) {
-    auto path_to_scene = std::string(
-		"D:/data/3d_model/sketchfab/sketchfab_3d_editor_challenge_littlest_tokyo/scene.gltf");
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(
-		path_to_scene,
-		aiProcess_Triangulate
-		| aiProcess_FlipUVs);
-    if(scene == nullptr) {
-		throw std::runtime_error(
-			"Failed to open 2D scene.");
-    }
+inline
+void load_scene(
+    LittlestTokyo& _this,
+    const scene_cache::Reader& cache,
+    const std::filesystem::path& scene_directory)
+{
     { // Meshes.
-        for(unsigned mi = 0; mi < scene->mNumMeshes; ++mi) {
-            auto& ai_mesh = *scene->mMeshes[mi];
+        auto records = cache.meshes();
+        _this.meshes.reserve(size(records));
+        for(auto& record : records) {
             auto& gl_mesh = _this.meshes.emplace_back();
-            gl_mesh.draw_mode = GL_TRIANGLES;
-            gl_mesh.draw_type = GL_UNSIGNED_INT;
-            if(ai_mesh.HasFaces()) {
-                auto indices = std::vector<unsigned>();
-                for(unsigned fi = 0; fi < ai_mesh.mNumFaces; ++fi) {
-                    auto& face = ai_mesh.mFaces[fi];
-                    for(unsigned ii = 0; ii < face.mNumIndices; ++ii) {
-                        indices.push_back(face.mIndices[ii]);
-                    }
-                }
-                gl_mesh.draw_count = GLsizei(size(indices));
-                gl::NamedBufferStorage(gl_mesh.indices, indices, gl::NONE);
+            gl_mesh.draw_mode = GLenum(record.draw_mode);
+            gl_mesh.draw_type = index_type(record.index_size);
+            gl_mesh.material = MaterialId(record.material);
+            gl_mesh.bounds = record.bounds;
+            gl_mesh.quantization = position_quantization(record.bounds);
+            gl_mesh.vertex_count = GLsizei(record.vertex_count);
+            gl_mesh.vertex_cache_before = record.vertex_cache_before;
+            gl_mesh.vertex_cache_after = record.vertex_cache_after;
+            if(record.normals != 0) {
+                gl_mesh.features |= bit(glsl::SolidFeature::has_normals);
             }
-            if(ai_mesh.HasNormals()) {
-                gl::NamedBufferStorage(gl_mesh.normals,
-                    std::span(ai_mesh.mNormals, ai_mesh.mNumVertices), gl::NONE);
-                
+            if(record.texcoords0 != 0) {
+                gl_mesh.features |= bit(glsl::SolidFeature::has_texcoords0);
             }
-            if(ai_mesh.HasPositions()) {
-                gl::NamedBufferStorage(gl_mesh.positions,
-                    std::span(ai_mesh.mVertices, ai_mesh.mNumVertices), gl::NONE);
+            if(record.indices != 0) {
+                gl_mesh.draw_count = GLsizei(record.index_count);
+            }
+            suballocate(_this.geometry, gl_mesh);
+        }
+        allocate_storage(_this.geometry);
+        // Uploaded straight from the cache, no intermediate copy.
+        auto& arena = _this.geometry;
+        for(std::size_t mi = 0; mi < size(records); ++mi) {
+            auto& record = records[mi];
+            auto& gl_mesh = _this.meshes[mi];
+            if(record.indices != 0) {
+                upload(arena.indices, gl_mesh.index_offset,
+                    cache.array<std::byte>(record.indices,
+                        std::size_t(record.index_count) * record.index_size));
+            }
+            if(record.normals != 0) {
+                upload_vertices(arena.normals, gl_mesh,
+                    cache.array<glm::vec3>(record.normals, record.vertex_count));
+            }
+            if(record.positions != 0) {
+                upload_vertices(arena.positions, gl_mesh,
+                    cache.array<glm::vec3>(record.positions, record.vertex_count));
+            }
+            if(record.texcoords0 != 0) {
+                upload_vertices(arena.texcoords0, gl_mesh,
+                    cache.array<glm::vec3>(record.texcoords0, record.vertex_count));
+            }
+            if(record.interleaved != 0) {
+                upload_vertices(arena.interleaved, gl_mesh,
+                    cache.array<InterleavedVertex>(record.interleaved, record.vertex_count));
+            }
+            if(record.quantized != 0) {
+                upload_vertices(arena.quantized, gl_mesh,
+                    cache.array<QuantizedVertex>(record.quantized, record.vertex_count));
             }
-			if(ai_mesh.HasTextureCoords(0)) {
-				gl::NamedBufferStorage(gl_mesh.texcoords0,
-					std::span(ai_mesh.mTextureCoords[0], ai_mesh.mNumVertices), gl::NONE);
-			}
         }
     }
     { // Nodes.
-        auto traversal = [&](SceneGraph& gl_node, const aiNode& ai_node, auto self) -> void {
-            gl_node.transform[0][0] = ai_node.mTransformation.a1;
-            gl_node.transform[0][1] = ai_node.mTransformation.a2;
-            gl_node.transform[0][2] = ai_node.mTransformation.a3;
-            gl_node.transform[0][3] = ai_node.mTransformation.a4;
-            gl_node.transform[1][0] = ai_node.mTransformation.b1;
-            gl_node.transform[1][1] = ai_node.mTransformation.b2;
-            gl_node.transform[1][2] = ai_node.mTransformation.b3;
-            gl_node.transform[1][3] = ai_node.mTransformation.b4;
-            gl_node.transform[2][0] = ai_node.mTransformation.c1;
-            gl_node.transform[2][1] = ai_node.mTransformation.c2;
-            gl_node.transform[2][2] = ai_node.mTransformation.c3;
-            gl_node.transform[2][3] = ai_node.mTransformation.c4;
-            gl_node.transform[3][0] = ai_node.mTransformation.d1;
-            gl_node.transform[3][1] = ai_node.mTransformation.d2;
-            gl_node.transform[3][2] = ai_node.mTransformation.d3;
-            gl_node.transform[3][3] = ai_node.mTransformation.d4;
-            gl_node.transform = glm::transpose(gl_node.transform);
-            for(unsigned mi = 0; mi < ai_node.mNumMeshes; ++mi) {
-                gl_node.meshes.push_back(MeshId(ai_node.mMeshes[mi]));
+        auto records = cache.nodes();
+        auto node_meshes = cache.node_meshes();
+        // Cache records are in preorder, already topological.
+        auto& sg = _this.scene;
+        auto mesh_ids = std::vector<MeshId>();
+        for(auto& record : records) {
+            mesh_ids.clear();
+            for(auto mi : node_meshes.subspan(record.first_mesh, record.mesh_count)) {
+                mesh_ids.push_back(MeshId(mi));
+            }
+            add_node(sg,
+                (record.parent == scene_cache::no_index) ? no_parent : record.parent,
+                glm::make_mat4(record.transform),
+                mesh_ids);
+        }
+        update_world_transforms(sg);
+    }
+    { // Occluders.
+        // Mesh data is only on the CPU while the cache is open.
+        _this.occlusion_culling = occlusion_culling(cache,
+            _this.scene, _this.meshes);
+    }
+    { // Textures.
+        for(auto& record : cache.textures()) {
+            auto& texture = _this.textures.emplace_back();
+            texture.file_path = scene_directory
+                / std::filesystem::path(cache.path(record));
+        }
+    }
+    { // Materials.
+        for(auto& record : cache.materials()) {
+            auto& material = _this.materials.emplace_back();
+            if(record.base_color_texture != scene_cache::no_index) {
+                material.base_color_texture = TextureId(record.base_color_texture);
             }
-            for(unsigned ci = 0; ci < ai_node.mNumChildren; ++ci) {
-                self(
-                    *gl_node.children.emplace_back(std::make_unique<SceneGraph>()),
-                    *ai_node.mChildren[ci],
-                    self);
+        }
+        for(auto& m : _this.meshes) {
+            if(_this.materials[m.material].base_color_texture) {
+                m.features |= bit(glsl::SolidFeature::base_color_texture);
             }
-        };
-        traversal(_this.scene, *scene->mRootNode, traversal);
+        }
     }
-	{// Materials.
-		_this.materials.resize(scene->mNumMaterials);
-		for(unsigned mi = 0; mi < scene->mNumMaterials; ++mi)
-		{
-			auto& ai_material = *scene->mMaterials[mi];
-			auto& our_material = _this.materials.emplace_back();
-			if(ai_material.GetTextureCount(aiTextureType_BASE_COLOR) > 0) {
-				auto texture_path = aiString();
-				ai_material.GetTexture(aiTextureType_BASE_COLOR, 0, &texture_path);
-
-			}
-		}
-	}
-	if constexpr(true) { // Materials.
-
-		for(unsigned mi = 0; mi < scene->mNumMaterials; ++mi)
-		{
-			auto& ai_material = *scene->mMaterials[mi];
-			std::cout << "Material: " << ai_material.GetName().C_Str() << '\n';
-			for(unsigned pi = 0; pi < ai_material.mNumProperties; ++pi) {
-				auto& ai_property = *ai_material.mProperties[pi];
-				aiTextureType;
-				aiPTI_Float;
-				std::cout << ai_property.mKey.C_Str() << " " << ai_property.mSemantic << " " << ai_property.mIndex << " " << ai_property.mDataLength << " " << ai_property.mType << '\n';
-				if(ai_property.mSemantic > 0) {
-					std::cout << "  " << ai_property.mSemantic << " " << ai_property.mType << '\n';
-				}
-			}
-			for(unsigned tt = 0; tt <= 30; ++tt) {
-				for(unsigned ti = 0; ti < ai_material.GetTextureCount(aiTextureType(tt)); ++ti) {
-					auto path = aiString();
-					ai_material.GetTexture(
-						aiTextureType(tt), ti,
-						&path,
-						NULL, NULL, NULL, NULL, NULL);
-					std::cout << "  Texture: " << tt << " " << path.C_Str() << " " << ti << '\n';
-				}
-			}
-		}
-		//aiTextureType_AMBIENT;
-	}
-	{ // Textures.
-		for(unsigned ti = 0; ti < scene->mNumTextures; ++ti) {
-			auto& ai_texture = *scene->mTextures[ti];
+}
 
-		}
-	}
+void init(LittlestTokyo& _this) {
+    auto path_to_scene = std::filesystem::path(
+		"D:/data/3d_model/sketchfab/sketchfab_3d_editor_challenge_littlest_tokyo/scene.gltf");
+    { // Programs, compiled by the driver while the scene loads.
+        _this.program_cache = glsl::program_cache(_this.program_cache_directory);
+        _this.shader_manager = glsl::shader_manager(&_this.program_cache);
+        submit(_this.shader_manager, _this.gpu_culling_programs);
+    }
+    { // Scene.
+        auto clock = Clock();
+        auto source_hash = scene_cache::source_hash(path_to_scene);
+        auto cache = scene_cache::Reader::open(_this.scene_cache_path, source_hash);
+        if(cache) {
+            auto open_seconds = clock.restart().count();
+            load_scene(_this, *cache, path_to_scene.parent_path());
+            auto upload_seconds = clock.restart().count();
+            auto seconds = open_seconds + upload_seconds;
+            auto import_seconds = cache->header().import_seconds;
+            std::cout << "Scene cache hit: loaded in " << 1000.f * seconds << " ms"
+                << " (hash and map: " << 1000.f * open_seconds << " ms"
+                << ", upload: " << 1000.f * upload_seconds << " ms"
+                << "; Assimp import: " << 1000.f * import_seconds << " ms"
+                << ", speedup: " << import_seconds / seconds << "x).\n";
+        } else {
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(
+                path_to_scene.string(),
+                scene_cache::import_flags);
+            if(scene == nullptr) {
+                throw std::runtime_error(
+                    "Failed to open 2D scene.");
+            }
+            auto import_seconds = clock.restart().count();
+            auto timings = scene_cache::Timings();
+            auto bytes = scene_cache::serialize(*scene,
+                source_hash, import_seconds,
+                _this.thread_pool, timings);
+            try {
+                scene_cache::write(_this.scene_cache_path, bytes);
+            } catch(const std::exception& e) {
+                std::cerr << "Scene cache not written: " << e.what() << '\n';
+            }
+            auto write_seconds = clock.restart().count();
+            cache = scene_cache::Reader::from_bytes(std::move(bytes), source_hash);
+            load_scene(_this, *cache, path_to_scene.parent_path());
+            auto upload_seconds = clock.restart().count();
+            std::cout << "Scene cache miss: imported in "
+                << 1000.f * import_seconds << " ms"
+                << " (layout: " << 1000.f * timings.layout_seconds << " ms"
+                << ", preparation on " << _this.thread_pool.size() + 1 << " threads: "
+                << 1000.f * timings.prepare_seconds << " ms"
+                << ", cache write: " << 1000.f * write_seconds << " ms"
+                << ", upload: " << 1000.f * upload_seconds << " ms).\n";
+        }
+    }
+    { // Textures.
+        _this.texture_streaming = texture_streaming();
+        _this.texture_arrays = texture_arrays();
+        _this.material_table = material_table(size(_this.materials));
+        request(_this.texture_streaming, _this.texture_pool, _this.textures,
+            _this.texture_cache_directory);
+    }
+    { // Frustum culling.
+        _this.frustum_culling = frustum_culling(_this.scene, _this.meshes);
+    }
+    { // Recorded draws.
+        _this.recorded_draws = recorded_draws(_this.scene);
+    }
+    { // GPU culling.
+        _this.gpu_culling = gpu_culling(_this.scene, _this.meshes);
+    }
     { // Solid renderer.
-        _this.solid_renderer = glsl::solid_renderer();
+        // Variants of the scene as first drawn, the others compile on first
+        // use. Meshes are skipped until their variant is linked.
+        auto features = std::vector<glsl::SolidFeatures>();
+        auto frame = frame_features(_this.shading, _this.vertex_format);
+        for(auto& m : _this.meshes) {
+            features.push_back(frame | m.features);
+        }
+        features.push_back(gizmo_features(_this.shading));
+        prewarm(_this.solid_variants, _this.shader_manager, features);
+        _this.frame_uniforms = frame_uniforms();
+        // Every mesh instance, the quad and the sphere; grows if needed.
+        _this.object_ring = object_ring(size(_this.scene.meshes) + 2);
     }
-    { // Meshes / Solid renderer vertex arrays.
-        _this.mesh_solid_renderer_vertex_arrays.resize(size(_this.meshes));
-        for(std::size_t i = 0; i < size(_this.meshes); ++i) {
-            _this.mesh_solid_renderer_vertex_arrays[i]
-            = vertex_array(_this.meshes[i], _this.solid_renderer);
+    { // Vertex arrays.
+        // Locations are fixed by the layouts, no program is needed.
+        _this.vertex_arrays = vertex_array_cache();
+        for(std::size_t f = 0; f < vertex_format_count; ++f) {
+            _this.geometry_buffers[f] = vertex_buffers(_this.geometry,
+                VertexFormat(f));
         }
     }
-    { // Camera.
-        _this.view_to_clip = glm::perspective(
+    { // Simulation.
+        auto view_to_clip = glm::perspective(
             3.141593f / 2.f,
             16.f / 9.f,
             0.1f,
             1000.f);
+        _this.simulation = simulation(_this.scene, view_to_clip);
+        // The first render must not see an empty snapshot.
+        write(_this.snapshots.back_slot(), _this.simulation);
+        _this.snapshots.publish();
     }
     if constexpr(false) {
-        auto traverse = [&](const SceneGraph& sg, glm::mat4 parent_transform, auto self) -> void {
-            parent_transform = parent_transform * sg.transform;
-            std::cout << "parent_transform:\n";
+        auto& sg = _this.scene;
+        for(std::size_t ni = 0; ni < node_count(sg); ++ni) {
+            std::cout << "world_transform:\n";
             for(int j = 0; j < 4; ++j) {
                 std::cout << "[";
                 for(int i = 0; i < 4; ++i) {
-                    std::cout << std::setw(16) << parent_transform[i][j] << " ";
+                    std::cout << std::setw(16) << sg.world_transforms[ni][i][j] << " ";
                 }
                 std::cout << "]\n";
             }
             std::cout << "\n";
-            std::cout << "sg.transform:\n";
+            std::cout << "local_transform:\n";
             for(int j = 0; j < 4; ++j) {
                 std::cout << "[";
                 for(int i = 0; i < 4; ++i) {
-                    std::cout << std::setw(16) << sg.transform[i][j] << " ";
+                    std::cout << std::setw(16) << sg.local_transforms[ni][i][j] << " ";
                 }
                 std::cout << "]\n";
             }
             std::cout << "\n\n";
-            for(auto& c : sg.children) {
-                self(*c, parent_transform, self);
-            }
-        };
-        // traverse(_this.scene, glm::mat4(1.f), traverse);
+        }
     }
 	{ // Quad.
-		_this.quad_solid_renderer = vertex_array(
-			_this.quad,
-			_this.solid_renderer);
+		// Drawn with 'VertexFormat::separate', positions stand in for the
+		// texcoords no gizmo variant reads.
+		auto& q = _this.quad;
+		_this.quad_buffers = VertexBuffers{
+			.indices = q.elements,
+			.buffers = {q.normals, q.positions, q.positions},
+			.offsets = {},
+			.strides = separate_vertex_layout.strides,
+		};
 	}
 	{ // Sphere.
-		_this.sphere_depth_renderer_va = vertex_array(
-			_this.sphere,
-			_this.depth_renderer);
-		_this.sphere_solid_renderer_va = vertex_array(
-			_this.sphere,
-			_this.solid_renderer);
+		// Unit sphere, normals are positions.
+		auto& s = _this.sphere;
+		_this.sphere_buffers = VertexBuffers{
+			.indices = s.elements,
+			.buffers = {s.normals_positions, s.normals_positions, s.normals_positions},
+			.offsets = {},
+			.strides = separate_vertex_layout.strides,
+		};
 	}
 	{ // Framebuffer.
 
 	}
 }
 
-void update(LittlestTokyo& _this) {
+// Main thread, after 'ImGui::NewFrame' so that keys, mouse moves and
+// captures are those of this frame.
+inline
+void forward_input(LittlestTokyo& _this) {
     auto& io = ImGui::GetIO();
-    if(not io.WantCaptureKeyboard) {
-        auto forward = glm::vec3(inverse(_this.world_to_view) * glm::vec4(0.f, 0.f, -1.f, 0.f));
-        auto right = glm::vec3(inverse(_this.world_to_view) * glm::vec4(+1.f, 0.f, 0.f, 0.f));
-        if(ImGui::IsKeyDown('A')) {
-            _this.camera_position += right * _this.camera_speed * _this.dt;
-        }
-        if(ImGui::IsKeyDown('D')) {
-            _this.camera_position -= right * _this.camera_speed * _this.dt;
-        }
-        if(ImGui::IsKeyDown('S')) {
-            _this.camera_position += forward * _this.camera_speed * _this.dt;
-        }
-        if(ImGui::IsKeyDown('W')) {
-            _this.camera_position -= forward * _this.camera_speed * _this.dt;
-        }
-    }
-    if(not io.WantCaptureMouse) {
-        if(ImGui::IsMouseDown(0)) {
-            _this.yaw_pitch += glm::vec2(io.MouseDelta[0], io.MouseDelta[1]) / 100.f;
-        }
+    auto& in = _this.input;
+    auto has_keyboard = not io.WantCaptureKeyboard;
+    in.left = has_keyboard and ImGui::IsKeyDown('A');
+    in.right = has_keyboard and ImGui::IsKeyDown('D');
+    in.backward = has_keyboard and ImGui::IsKeyDown('S');
+    in.forward = has_keyboard and ImGui::IsKeyDown('W');
+    if(not io.WantCaptureMouse and ImGui::IsMouseDown(0)) {
+        in.drag += glm::vec2(io.MouseDelta[0], io.MouseDelta[1]);
     }
-    { // Camera.
-        _this.world_to_view = glm::translate(
-            glm::rotate(
-                glm::rotate(
-                    glm::mat4(1.f),
-                    _this.yaw_pitch.y,
-                    glm::vec3(1.f, 0.f, 0.f)),
-                _this.yaw_pitch.x,
-                glm::vec3(0.f, 1.f, 0.f)),
-            _this.camera_position);
-        _this.world_to_clip = _this.view_to_clip * _this.world_to_view;
+    _this.inputs.back_slot() = in;
+    _this.inputs.publish();
+}
+
+// Update thread, or the main one when not threaded.
+inline
+void update(LittlestTokyo& _this) {
+    _this.inputs.acquire();
+    update(_this.simulation, _this.inputs.front_slot());
+    write(_this.snapshots.back_slot(), _this.simulation);
+    _this.snapshots.publish();
+}
+
+// Render thread. Takes the latest snapshot and brings the scene state that
+// depends on world transforms up to date, GL work included.
+inline
+const Snapshot& acquire_snapshot(LittlestTokyo& _this) {
+    _this.snapshots.acquire();
+    auto& snapshot = _this.snapshots.front_slot();
+    _this.transform_update_count = 0;
+    if(snapshot.transform_version != _this.transform_version) {
+        _this.scene.world_transforms = snapshot.world_transforms;
+        _this.transform_version = snapshot.transform_version;
+        _this.transform_update_count = snapshot.transform_update_count;
+        refit(_this.frustum_culling, _this.scene, _this.meshes);
+        refit(_this.occlusion_culling, _this.scene);
+        refit(_this.gpu_culling, _this.scene, _this.meshes);
+        invalidate(_this.recorded_draws);
     }
+    return snapshot;
+}
+
+// Camera 'alpha' of the way through the update of 'snapshot'.
+inline
+FrameData frame_data(const Snapshot& snapshot, float alpha) {
+    auto world_to_view = ::world_to_view(
+        mix(snapshot.previous_camera, snapshot.camera, alpha));
+    return {
+        .world_to_view = world_to_view,
+        .view_to_clip = snapshot.view_to_clip,
+        .world_to_clip = snapshot.view_to_clip * world_to_view,
+    };
 }
 
 inline
@@ -290,131 +454,513 @@ void render_ui(LittlestTokyo& _this)
 	if(ImGui::Begin("Settings")) {
 		if(ImGui::TreeNode("Camera")) {
 			ImGui::DragFloat("Speed",
-				&_this.camera_speed,
+				&_this.input.camera_speed,
 				1.0f, 0.0f, 100.0f, "%.3f",
 				ImGuiSliderFlags_Logarithmic);
 			ImGui::TreePop();
 		}
 		if(ImGui::TreeNode("Plane")) {
 			ImGui::DragFloat3("Position",
-				&_this.quad_position[0],
+				&_this.input.gizmos.quad_position[0],
 				1.0f, 0.0f, 100.0f, "%.3f");
 			ImGui::DragFloat("Scale",
-				&_this.quad_scale,
+				&_this.input.gizmos.quad_scale,
 				1.0f, 1.0f, 100.0f, "%.3f");
 			ImGui::TreePop();
 		}
 		if(ImGui::TreeNode("Hole")) {
 			ImGui::DragFloat3("Position",
-				&_this.sphere_position[0],
+				&_this.input.gizmos.sphere_position[0],
 				1.0f, 0.0f, 100.0f, "%.3f");
 			ImGui::DragFloat3("Scale",
-				&_this.sphere_scale[0],
+				&_this.input.gizmos.sphere_scale[0],
 				1.0f, 0.0f, 100.0f, "%.3f");
+			ImGui::Checkbox("Draw", &_this.input.gizmos.draw_sphere);
+			ImGui::TreePop();
+		}
+		if(ImGui::TreeNode("Rendering")) {
+			auto mode = int(_this.render_mode);
+			if(ImGui::Combo("Mode", &mode,
+				render_mode_names, int(render_mode_count)))
+			{
+				_this.render_mode = RenderMode(mode);
+			}
+			for(std::size_t m = 0; m < render_mode_count; ++m) {
+				auto& stats = _this.render_stats[m];
+				ImGui::Text("%s: %zu draw calls, %zu meshes, submit %.3f ms",
+					render_mode_names[m],
+					stats.draw_calls, stats.mesh_instances,
+					1000.f * stats.submit_seconds);
+			}
+			ImGui::Text("Scene: %zu nodes, %zu world transforms updated (%s)",
+				node_count(_this.scene), _this.transform_update_count,
+				transform::isa_names[std::size_t(transform::best_isa())]);
+			{ // Frustum culling.
+				auto& fc = _this.frustum_culling;
+				ImGui::Checkbox("Frustum culling", &fc.is_enabled);
+				ImGui::Text("Nodes: %zu visible, %zu culled, %zu BVH node tests, %.3f ms",
+					fc.visible_count, fc.culled_count, fc.node_tests,
+					1000.f * fc.seconds);
+			}
+			{ // Occlusion culling.
+				auto& oc = _this.occlusion_culling;
+				ImGui::Checkbox("Occlusion culling", &oc.is_enabled);
+				ImGui::Text("Occluders: %zu of %zu triangles rasterized",
+					oc.rasterized_count, size(oc.occluder_indices) / 3);
+				ImGui::Text("Nodes: %zu occluded, raster %.3f ms, tests %.3f ms",
+					oc.occluded_count,
+					1000.f * oc.rasterize_seconds,
+					1000.f * oc.test_seconds);
+			}
+			{ // Render queue.
+				auto& rq = _this.render_queue;
+				ImGui::Text("Render queue: %zu draws", size(rq.items));
+				ImGui::Text("Binds unsorted: %zu programs, %zu vertex arrays, %zu material runs",
+					rq.unsorted_binds.programs, rq.unsorted_binds.vertex_arrays,
+					rq.unsorted_binds.material_runs);
+				ImGui::Text("Binds sorted: %zu programs, %zu vertex arrays, %zu material runs",
+					rq.sorted_binds.programs, rq.sorted_binds.vertex_arrays,
+					rq.sorted_binds.material_runs);
+			}
+			{ // Textures.
+				auto& ts = _this.texture_streaming;
+				ImGui::Text("Textures: %zu of %zu resident, %zu failed, %zu cached, %.1f MB/s",
+					ts.resident_count, ts.requested_count, ts.failed_count,
+					ts.cache_hit_count, throughput(ts));
+				ImGui::Text("Texture memory: %.2f MiB (%.2f MiB as RGBA8)",
+					float(ts.resident_bytes) / float(1 << 20),
+					float(ts.rgba8_bytes) / float(1 << 20));
+				ImGui::Text("Texture arrays: %zu of %zu units, %zu grown",
+					size(_this.texture_arrays.arrays), max_texture_array_count,
+					_this.texture_arrays.grow_count);
+			}
+			{ // Instancing.
+				auto& in = _this.instancing;
+				ImGui::Text("Instancing: %zu draws collapsed into %zu",
+					in.collapsed_draw_count, size(in.groups));
+			}
+			{ // Recorded draws.
+				auto& rd = _this.recorded_draws;
+				ImGui::Text("Recorded: %zu of %zu partitions, %zu threads",
+					rd.recorded_count, size(rd.partitions),
+					_this.thread_pool.size() + 1);
+			}
+			{ // Programs.
+				auto& sm = _this.shader_manager;
+				ImGui::Text("Programs: %zu of %zu linked, %zu failed%s",
+					sm.linked_count, sm.submitted_count, sm.failed_count,
+					sm.is_parallel ? ", parallel" : "");
+				ImGui::Text("Solid renderer variants: %zu",
+					size(_this.solid_variants.features));
+			}
+			{ // GPU culling.
+				auto& gc = _this.gpu_culling;
+				ImGui::Checkbox("GPU occlusion culling", &gc.use_depth_pyramid);
+				ImGui::Checkbox("Show GPU culled instances", &gc.debug_view);
+				ImGui::Text("GPU: %zu instances in %zu batches, depth pyramid %dx%d (%d levels)",
+					size(gc.instances), size(gc.batches),
+					gc.depth_pyramid_width, gc.depth_pyramid_height,
+					gc.depth_pyramid_level_count);
+			}
+			auto shading = int(_this.shading);
+			if(ImGui::Combo("Shading", &shading,
+				shading_names, int(shading_count)))
+			{
+				_this.shading = Shading(shading);
+			}
+			auto format = int(_this.vertex_format);
+			if(ImGui::Combo("Vertex format", &format,
+				vertex_format_names, int(vertex_format_count)))
+			{
+				_this.vertex_format = VertexFormat(format);
+			}
+			{ // Vertex memory.
+				auto bytes = std::array<std::size_t, vertex_format_count>();
+				for(auto& m : _this.meshes) {
+					for(std::size_t f = 0; f < vertex_format_count; ++f) {
+						bytes[f] += m.vertex_count
+							* vertex_size(VertexFormat(f), 3);
+					}
+				}
+				for(std::size_t f = 0; f < vertex_format_count; ++f) {
+					ImGui::Text("%s: %.2f MiB", vertex_format_names[f],
+						float(bytes[f]) / float(1 << 20));
+				}
+			}
+			ImGui::Text("Geometry arena: %zu vertices, %.2f MiB indices",
+				_this.geometry.vertex_count,
+				float(_this.geometry.index_size) / float(1 << 20));
+			ImGui::Text("Vertex arrays: %zu shared, %zu buffer switches",
+				vertex_format_count, _this.vertex_arrays.switch_count);
+			ImGui::TreePop();
+		}
+		if(ImGui::TreeNode("Meshes")) {
+			auto index_type_name = [](GLenum type) {
+				switch(type) {
+				case GL_UNSIGNED_BYTE: return "u8";
+				case GL_UNSIGNED_SHORT: return "u16";
+				default: return "u32";
+				}
+			};
+			{ // Summary.
+				auto triangle_count = 0.f;
+				auto misses_before = 0.f;
+				auto misses_after = 0.f;
+				auto index_bytes = std::size_t(0);
+				for(auto& m : _this.meshes) {
+					auto triangles = float(m.draw_count) / 3.f;
+					triangle_count += triangles;
+					misses_before += m.vertex_cache_before.acmr * triangles;
+					misses_after += m.vertex_cache_after.acmr * triangles;
+					index_bytes += m.draw_count * index_size(m.draw_type);
+				}
+				if(triangle_count > 0.f) {
+					ImGui::Text("ACMR: %.3f -> %.3f",
+						misses_before / triangle_count,
+						misses_after / triangle_count);
+				}
+				ImGui::Text("Index memory: %.2f MiB (%.2f MiB with u32)",
+					float(index_bytes) / float(1 << 20),
+					4.f * 3.f * triangle_count / float(1 << 20));
+			}
+			if(ImGui::TreeNode("Vertex cache per mesh")) {
+				for(std::size_t mi = 0; mi < size(_this.meshes); ++mi) {
+					auto& m = _this.meshes[mi];
+					ImGui::Text("%zu: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %s",
+						mi,
+						m.vertex_cache_before.acmr, m.vertex_cache_after.acmr,
+						m.vertex_cache_before.atvr, m.vertex_cache_after.atvr,
+						index_type_name(m.draw_type));
+				}
+				ImGui::TreePop();
+			}
 			ImGui::TreePop();
 		}
 	}
 	ImGui::End();
 }
 
-void render(LittlestTokyo& _this)
+// Binds the solid renderer variant of 'features' unless 'program', the last
+// bound, is already it. False until it is linked.
+inline
+bool use_variant(
+	LittlestTokyo& _this,
+	glsl::SolidFeatures features,
+	GLuint& program)
 {
-	gl::ClearNamedFramebuffer(gl::ZERO, gl::COLOR, 0, {0.f, 0.f, 0.f, 1.f});
-	gl::ClearNamedFramebuffer(gl::ZERO, gl::DEPTH, 1.f);
+	auto& sr = variant(_this.solid_variants, _this.shader_manager, features);
+	if(not sr.is_ready) {
+		return false;
+	}
+	if(sr.program != program) {
+		program = sr.program;
+		gl::UseProgram(program);
+	}
+	return true;
+}
+
+// 'alpha' in [0, 1), see 'Scheduler::on_render'.
+void render(LittlestTokyo& _this, float alpha)
+{
+	auto& snapshot = acquire_snapshot(_this);
+	auto frame = frame_data(snapshot, alpha);
+
+	{ // Render target.
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		resize(_this.render_target, viewport[2], viewport[3]);
+		glBindFramebuffer(GL_FRAMEBUFFER, _this.render_target.framebuffer);
+	}
+	gl::ClearNamedFramebuffer(_this.render_target.framebuffer,
+		gl::COLOR, 0, {0.f, 0.f, 0.f, 1.f});
+	gl::ClearNamedFramebuffer(_this.render_target.framebuffer,
+		gl::DEPTH, 1.f);
+
+	{ // Frame and object blocks.
+		upload(_this.frame_uniforms, frame);
+		begin_frame(_this.object_ring);
+		clear(_this.render_queue);
+	}
+	{ // Programs.
+		poll(_this.shader_manager);
+	}
+	{ // Textures.
+		update(_this.texture_streaming, _this.texture_arrays, _this.textures);
+		update(_this.material_table, _this.materials, _this.textures);
+	}
+
+	// Indices of the render queue keys, programs are variant indices.
+	enum : std::uint64_t {
+		// Then one per 'VertexFormat'.
+		quad_vertex_array = vertex_format_count,
+		sphere_vertex_array,
+	};
+	auto view_depth = [&](const glm::mat4& object_to_world, const Aabb& bounds) {
+		auto c = frame.world_to_view * object_to_world
+			* glm::vec4(is_empty(bounds) ? glm::vec3(0.f) : center(bounds), 1.f);
+		return -c.z;
+	};
+
+	// Direct mode draws are submitted with the render queue, timed there.
+	auto direct_stats = static_cast<RenderStats*>(nullptr);
+	auto direct_seconds = 0.f;
 
 	{ // Littlest tokyo.
-		gl::UseProgram(_this.solid_renderer.program);
+		auto clock = Clock();
+		auto format = _this.vertex_format;
+		auto mode = _this.render_mode;
+		if(mode == RenderMode::gpu_driven
+			and not is_ready(_this.gpu_culling_programs))
+		{
+			// Until its programs are linked.
+			mode = RenderMode::multi_draw_indirect;
+		}
+		auto features = frame_features(_this.shading, format);
+		auto program = GLuint(0);
+		auto use_features = [&](glsl::SolidFeatures fs) {
+			return use_variant(_this, features | fs, program);
+		};
+		auto& stats = _this.render_stats[std::size_t(mode)];
+		stats.draw_calls = 0;
+		stats.mesh_instances = 0;
+
+		if(mode == RenderMode::gpu_driven) {
+			cull(_this.gpu_culling, _this.gpu_culling_programs,
+				frame.world_to_clip, format == VertexFormat::quantized);
+		} else {
+			// Would be tested against a stale camera when switching back.
+			_this.gpu_culling.has_depth_pyramid = false;
+		}
+
+		auto& geometry_buffers = _this.geometry_buffers[std::size_t(format)];
+		auto vertex_array = bind_buffers(_this.vertex_arrays, format,
+			geometry_buffers);
+		gl::BindVertexArray(vertex_array);
+		// After 'cull', which samples the depth pyramid on unit 0.
+		bind(_this.texture_arrays);
 
 		glDepthFunc(GL_LESS);
 		auto depth_cap = scoped(gl::Enable(GL_DEPTH_TEST));
 
-		auto traverse_and_draw = [&](const SceneGraph &sg,
-			glm::mat4 parent_transform, auto self) -> void {
-			parent_transform = parent_transform * sg.transform;
-			auto object_to_clip = _this.world_to_clip * parent_transform;
-
-			glProgramUniformMatrix4fv(_this.solid_renderer.program,
-				_this.solid_renderer.object_to_clip,
-				1, GL_FALSE, &object_to_clip[0][0]);
-			glProgramUniformMatrix4fv(_this.solid_renderer.program,
-				_this.solid_renderer.object_to_world_position,
-				1, GL_FALSE, &parent_transform[0][0]);
-
-			for(auto mi: sg.meshes) {
-				auto &mesh = _this.meshes[mi];
-				auto &va = _this.mesh_solid_renderer_vertex_arrays[mi];
+		if(mode != RenderMode::gpu_driven) {
+			cull(_this.frustum_culling, frame.world_to_clip);
+			cull(_this.occlusion_culling, _this.frustum_culling, frame.world_to_clip);
+		}
+		auto& visible = _this.frustum_culling.visible;
 
-				gl::BindVertexArray(va);
+		auto quantization = [&](const Mesh& mesh) {
+			return (format == VertexFormat::quantized)
+				? mesh.quantization
+				: PositionQuantization();
+		};
 
-				gl::DrawElements(mesh.draw_mode,
-					mesh.draw_count,
-					mesh.draw_type,
-					0);
+		if(mode == RenderMode::direct) {
+			auto& objects = _this.direct_objects;
+			auto& direct_meshes = _this.direct_meshes;
+			auto& depths = _this.direct_depths;
+			objects.clear();
+			direct_meshes.clear();
+			depths.clear();
+			auto& sg = _this.scene;
+			for(std::size_t ni = 0; ni < node_count(sg); ++ni) {
+				if(sg.mesh_counts[ni] == 0 or not visible[ni]) {
+					continue;
+				}
+				for(auto mi: meshes(sg, ni)) {
+					auto& mesh = _this.meshes[mi];
+					objects.push_back(object_data(sg.world_transforms[ni],
+						quantization(mesh), material_index(mesh.material)));
+					direct_meshes.push_back(mi);
+					depths.push_back(view_depth(sg.world_transforms[ni], mesh.bounds));
+				}
 			}
-			for(auto &c: sg.children) {
-				self(*c, parent_transform, self);
+			auto first_object = write(_this.object_ring, objects);
+			for(std::size_t i = 0; i < size(direct_meshes); ++i) {
+				auto &mesh = _this.meshes[direct_meshes[i]];
+				auto vi = variant_index(_this.solid_variants,
+					_this.shader_manager, features | mesh.features);
+				auto& sr = *_this.solid_variants.renderers[vi];
+				if(not sr.is_ready) {
+					continue;
+				}
+				// The base instance selects the object, no uniform update.
+				push(_this.render_queue,
+					render_key(RenderPass::opaque, vi,
+						std::uint64_t(format), mesh.material, depths[i]),
+					RenderItem{
+						.program = sr.program,
+						.format = format,
+						.buffers = &geometry_buffers,
+						.mode = mesh.draw_mode,
+						.count = mesh.draw_count,
+						.type = mesh.draw_type,
+						.index_offset = mesh.index_offset,
+						.base_vertex = mesh.base_vertex,
+						.base_instance = first_object + GLuint(i),
+					});
+				stats.draw_calls += 1;
 			}
-		};
-		traverse_and_draw(_this.scene, glm::mat4(1.f), traverse_and_draw);
+			// Submitted with the gizmos once sorted.
+			stats.mesh_instances = stats.draw_calls;
+		} else if(mode == RenderMode::gpu_driven) {
+			stats.draw_calls = draw(_this.gpu_culling, use_features);
+			// Tested, the visible count stays on the GPU.
+			stats.mesh_instances = size(_this.gpu_culling.instances);
+		} else if(mode == RenderMode::recorded) {
+			auto& rd = _this.recorded_draws;
+			_this.mesh_programs.clear();
+			for(auto& mesh : _this.meshes) {
+				auto& sr = variant(_this.solid_variants, _this.shader_manager,
+					features | mesh.features);
+				_this.mesh_programs.push_back(sr.is_ready ? GLuint(sr.program) : 0);
+			}
+			record(rd, _this.thread_pool, _this.scene, _this.meshes,
+				visible, format, features, _this.mesh_programs,
+				vertex_array);
+			stats.draw_calls = execute(rd, _this.object_ring);
+			stats.mesh_instances = stats.draw_calls;
+		} else if(mode == RenderMode::instanced) {
+			auto& in = _this.instancing;
+			clear(in);
+			auto& sg = _this.scene;
+			for(std::size_t ni = 0; ni < node_count(sg); ++ni) {
+				if(sg.mesh_counts[ni] == 0 or not visible[ni]) {
+					continue;
+				}
+				for(auto mi: meshes(sg, ni)) {
+					auto &mesh = _this.meshes[mi];
+					push(in, mi, mesh, object_data(sg.world_transforms[ni],
+						quantization(mesh), material_index(mesh.material)));
+				}
+			}
+			upload(in, size(_this.meshes), _this.object_ring);
+			stats.draw_calls = draw(in, _this.meshes, use_features);
+			stats.mesh_instances = size(in.objects);
+		} else {
+			auto& md = _this.multi_draw;
+			clear(md);
+			auto& sg = _this.scene;
+			for(std::size_t ni = 0; ni < node_count(sg); ++ni) {
+				if(sg.mesh_counts[ni] == 0 or not visible[ni]) {
+					continue;
+				}
+				for(auto mi: meshes(sg, ni)) {
+					auto &mesh = _this.meshes[mi];
+					push(md, mesh, object_data(sg.world_transforms[ni],
+						quantization(mesh), material_index(mesh.material)));
+				}
+			}
+			upload(md, _this.object_ring);
+			stats.draw_calls = draw(md, use_features);
+			stats.mesh_instances = size(md.commands);
+		}
+		if(mode == RenderMode::direct) {
+			direct_stats = &stats;
+			direct_seconds = clock.restart().count();
+		} else {
+			record_submit(stats, clock.restart().count());
+		}
 	}
 
-	{ // Quad.
-		gl::UseProgram(_this.solid_renderer.program);
-
-		gl::BindVertexArray(_this.quad_solid_renderer);
+	// Of the quad and the sphere, drawn once linked.
+	auto gizmo_variant = variant_index(_this.solid_variants,
+		_this.shader_manager, gizmo_features(_this.shading));
+	auto& gizmo_renderer = *_this.solid_variants.renderers[gizmo_variant];
 
+	if(gizmo_renderer.is_ready) { // Quad.
 		auto object_to_world = glm::translate(
 			glm::scale(
 				glm::identity<glm::mat4>(),
-				glm::vec3(_this.quad_scale)),
-			_this.quad_position);
-
-		auto object_to_clip = _this.world_to_clip * object_to_world;
-
-		glProgramUniformMatrix4fv(_this.solid_renderer.program,
-			_this.solid_renderer.object_to_clip,
-			1, GL_FALSE,
-			&object_to_clip[0][0]);
-		glProgramUniformMatrix4fv(_this.solid_renderer.program,
-			_this.solid_renderer.object_to_world_position,
-			1, GL_FALSE,
-			&object_to_world[0][0]);
-
-		gl::DrawElements(
-			_this.quad.mode,
-			_this.quad.count,
-			_this.quad.type,
-			0);
+				glm::vec3(snapshot.gizmos.quad_scale)),
+			snapshot.gizmos.quad_position);
+
+		auto object = object_data(object_to_world);
+		auto first_object = write(_this.object_ring,
+			std::span<const ObjectData>(&object, 1));
+
+		push(_this.render_queue,
+			render_key(RenderPass::opaque, gizmo_variant, quad_vertex_array,
+				0, view_depth(object_to_world, Aabb())),
+			RenderItem{
+				.program = gizmo_renderer.program,
+				.format = VertexFormat::separate,
+				.buffers = &_this.quad_buffers,
+				.mode = _this.quad.mode,
+				.count = _this.quad.count,
+				.type = _this.quad.type,
+				.index_offset = 0,
+				.base_vertex = 0,
+				.base_instance = first_object,
+			});
 	}
 
-	if constexpr(false) { // Sphere.
-		gl::UseProgram(_this.solid_renderer.program);
-
-		gl::BindVertexArray(_this.sphere_solid_renderer_va);
-
+	if(snapshot.gizmos.draw_sphere and gizmo_renderer.is_ready) { // Sphere.
 		auto object_to_world = glm::translate(
 			glm::scale(
 				glm::identity<glm::mat4>(),
-				_this.sphere_scale),
-			_this.sphere_position);
-
-		auto object_to_clip = _this.world_to_clip * object_to_world;
-
-		glProgramUniformMatrix4fv(_this.solid_renderer.program,
-			_this.solid_renderer.object_to_clip,
-			1, GL_FALSE,
-			&object_to_clip[0][0]);
-		glProgramUniformMatrix4fv(_this.solid_renderer.program,
-			_this.solid_renderer.object_to_world_position,
-			1, GL_FALSE,
-			&object_to_world[0][0]);
-
-		gl::DrawElements(
-			_this.sphere.mode,
-			_this.sphere.count,
-			_this.sphere.type,
-			0);
+				snapshot.gizmos.sphere_scale),
+			snapshot.gizmos.sphere_position);
+
+		auto object = object_data(object_to_world);
+		auto first_object = write(_this.object_ring,
+			std::span<const ObjectData>(&object, 1));
+
+		push(_this.render_queue,
+			render_key(RenderPass::opaque, gizmo_variant, sphere_vertex_array,
+				0, view_depth(object_to_world, Aabb())),
+			RenderItem{
+				.program = gizmo_renderer.program,
+				.format = VertexFormat::separate,
+				.buffers = &_this.sphere_buffers,
+				.mode = _this.sphere.mode,
+				.count = _this.sphere.count,
+				.type = _this.sphere.type,
+				.index_offset = 0,
+				.base_vertex = 0,
+				.base_instance = first_object,
+			});
 	}
 
+	{ // Render queue.
+		auto depth_cap = scoped(gl::Enable(GL_DEPTH_TEST));
+		auto clock = Clock();
+		sort(_this.render_queue);
+		submit(_this.render_queue, _this.vertex_arrays);
+		if(direct_stats != nullptr) {
+			// The gizmo pushes are left out, their few draws are not.
+			record_submit(*direct_stats,
+				direct_seconds + clock.restart().count());
+		}
+	}
+
+	if(_this.render_mode == RenderMode::gpu_driven
+		and is_ready(_this.gpu_culling_programs))
+	{ // GPU culling.
+		auto& gc = _this.gpu_culling;
+		auto& rt = _this.render_target;
+		build_depth_pyramid(gc, _this.gpu_culling_programs,
+			rt.depth, rt.width, rt.height, frame.world_to_clip);
+		if(gc.debug_view) {
+			// Over the frame and out of the depth pyramid.
+			auto features = frame_features(_this.shading, _this.vertex_format)
+				| bit(glsl::SolidFeature::culled_tint);
+			auto program = GLuint(0);
+			auto use_features = [&](glsl::SolidFeatures fs) {
+				return use_variant(_this, features | fs, program);
+			};
+			auto format = _this.vertex_format;
+			gl::BindVertexArray(bind_buffers(_this.vertex_arrays, format,
+				_this.geometry_buffers[std::size_t(format)]));
+			bind(_this.texture_arrays);
+			glDepthMask(GL_FALSE);
+			draw(gc, use_features, 1);
+			glDepthMask(GL_TRUE);
+		}
+	}
+
+	end_frame(_this.object_ring);
+
+	present(_this.render_target);
+
 	render_ui(_this);
 }
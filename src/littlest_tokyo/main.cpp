@@ -1,3 +1,6 @@
+// Decoders of 'common/image/decode.hpp'.
+#define STB_IMAGE_IMPLEMENTATION
+
 #include "common/dependency/glfw_opengl.hpp"
 #include "common/dependency/imgui_glfw_opengl.hpp"
 #include "common/dependency/imgui_glfw_opengl.hpp"
@@ -87,17 +90,32 @@ void throwing_main() {
         scheduler.on_init = [&]() {
             init(app);
         };
+        // GLFW must be polled on the main thread.
+        scheduler.on_input = [&]() {
+            glfwPollEvents();
+        };
         scheduler.time_per_render = 1.f / 60.f;
-        scheduler.on_render = [&]() {
+        scheduler.on_render = [&](float alpha) {
 
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
 
-            render(app);
+            forward_input(app);
+
+            render(app, alpha);
 
             ImGui::ShowDemoWindow();
 
+            if(ImGui::Begin("Frame pacing")) {
+                auto& stats = scheduler.stats;
+                ImGui::Text("Frame: %.2f ms mean, %.2f ms p99",
+                    1000.f * mean(stats), 1000.f * percentile(stats, 0.99f));
+                ImGui::Text("%zu missed deadlines, %zu updates dropped",
+                    stats.missed_count, stats.dropped_update_count);
+            }
+            ImGui::End();
+
             ImGui::Render();
             int display_w, display_h;
             glfwGetFramebufferSize(window, &display_w, &display_h);
@@ -108,10 +126,9 @@ void throwing_main() {
         };
         scheduler.time_per_update = 1.f / 60.f;
         scheduler.on_update = [&]() {
-            glfwPollEvents();
-
             update(app);
         };
+        scheduler.is_update_threaded = true;
         run(scheduler);
     }
 }
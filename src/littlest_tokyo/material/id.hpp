@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdlib>
+
+struct MaterialId {
+    std::size_t value = 0;
+
+    MaterialId() = default;
+
+    explicit
+    MaterialId(std::size_t value)
+        : value(value)
+    {}
+
+    operator std::size_t() const noexcept {
+        return value;
+    }
+};
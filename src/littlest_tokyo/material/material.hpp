@@ -0,0 +1,9 @@
+#pragma once
+
+#include "../texture/id.hpp"
+
+#include <optional>
+
+struct Material {
+    std::optional<TextureId> base_color_texture;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "id.hpp"
+#include "material.hpp"
+#include "../texture/texture.hpp"
+#include "../texture/texture_arrays.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+// 'Material' in 'solid_renderer/shader.frag', std430.
+struct MaterialData {
+    GLuint base_color_array;
+    GLuint base_color_layer;
+    GLuint padding[2];
+};
+
+static_assert(sizeof(MaterialData) == 16);
+
+// Entry 0 is untextured, material 'm' is entry 'm + 1'.
+inline constexpr std::uint32_t untextured_material = 0;
+
+inline
+std::uint32_t material_index(MaterialId m) {
+    return std::uint32_t(m) + 1;
+}
+
+// Storage buffer of every material, indexed per object by
+// 'ObjectData::position_scale.w'.
+struct MaterialTable {
+    gl::BufferObj buffer;
+    std::vector<MaterialData> materials;
+    std::vector<MaterialData> scratch;
+};
+
+inline
+MaterialTable material_table(std::size_t material_count) {
+    auto mt = MaterialTable();
+    auto placeholder = MaterialData{
+        placeholder_layer.array, placeholder_layer.layer, {0, 0}};
+    mt.materials.assign(material_count + 1, placeholder);
+    glNamedBufferStorage(mt.buffer,
+        GLsizeiptr(size(mt.materials) * sizeof(MaterialData)),
+        mt.materials.data(), GL_DYNAMIC_STORAGE_BIT);
+    return mt;
+}
+
+// Points materials to their resident textures, uploads only on change.
+// Also binds the table to storage buffer binding 5.
+inline
+void update(
+    MaterialTable& mt,
+    std::span<const Material> materials,
+    std::span<const TextureResource> textures)
+{
+    mt.scratch = mt.materials;
+    for(std::size_t mi = 0; mi < size(materials); ++mi) {
+        auto& t = materials[mi].base_color_texture;
+        auto layer = (t and textures[*t].layer)
+            ? *textures[*t].layer
+            : placeholder_layer;
+        auto& entry = mt.scratch[material_index(MaterialId(mi))];
+        entry.base_color_array = layer.array;
+        entry.base_color_layer = layer.layer;
+    }
+    if(not std::equal(begin(mt.scratch), end(mt.scratch), begin(mt.materials),
+        [](auto& a, auto& b) {
+            return a.base_color_array == b.base_color_array
+                and a.base_color_layer == b.base_color_layer;
+        }))
+    {
+        mt.materials.swap(mt.scratch);
+        glNamedBufferSubData(mt.buffer, 0,
+            GLsizeiptr(size(mt.materials) * sizeof(MaterialData)),
+            mt.materials.data());
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, mt.buffer);
+}
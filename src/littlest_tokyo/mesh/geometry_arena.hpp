@@ -0,0 +1,78 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+
+#include <cstdlib>
+#include <span>
+
+// Every mesh is a range of one shared index buffer and of one shared buffer
+// per vertex stream, so a single vertex array per format draws the scene.
+struct GeometryArena {
+    gl::BufferObj indices;
+
+    // 'VertexFormat::separate'.
+    gl::BufferObj normals;
+    gl::BufferObj positions;
+    gl::BufferObj texcoords0;
+
+    gl::BufferObj interleaved;
+    gl::BufferObj quantized;
+
+    // Bytes, index ranges of different types are aligned to 4 bytes.
+    std::size_t index_size = 0;
+    std::size_t vertex_count = 0;
+};
+
+// Reserves the ranges of 'm', before 'allocate_storage'.
+inline
+void suballocate(GeometryArena& a, Mesh& m) {
+    a.index_size = (a.index_size + 3) & ~std::size_t(3);
+    m.index_offset = a.index_size;
+    m.base_vertex = GLint(a.vertex_count);
+    a.index_size += std::size_t(m.draw_count) * index_size(m.draw_type);
+    a.vertex_count += std::size_t(m.vertex_count);
+}
+
+// Zero filled, so attributes missing from a mesh read as zero.
+inline
+void allocate_storage(GeometryArena& a) {
+    auto storage = [](const gl::BufferObj& b, std::size_t size) {
+        if(size > 0) {
+            glNamedBufferStorage(b, GLsizeiptr(size), nullptr,
+                GL_DYNAMIC_STORAGE_BIT);
+            glClearNamedBufferData(b, GL_R8UI, GL_RED_INTEGER,
+                GL_UNSIGNED_BYTE, nullptr);
+        }
+    };
+    storage(a.indices, a.index_size);
+    storage(a.normals, a.vertex_count * sizeof(glm::vec3));
+    storage(a.positions, a.vertex_count * sizeof(glm::vec3));
+    storage(a.texcoords0, a.vertex_count * sizeof(glm::vec3));
+    storage(a.interleaved, a.vertex_count * sizeof(InterleavedVertex));
+    storage(a.quantized, a.vertex_count * sizeof(QuantizedVertex));
+}
+
+// 'offset' in bytes.
+inline
+void upload(
+    const gl::BufferObj& b,
+    std::size_t offset,
+    std::span<const std::byte> data)
+{
+    if(not data.empty()) {
+        glNamedBufferSubData(b, GLintptr(offset),
+            GLsizeiptr(data.size()), data.data());
+    }
+}
+
+// 'data' holds the vertices of 'm' starting at its base vertex.
+template<typename T>
+void upload_vertices(
+    const gl::BufferObj& b,
+    const Mesh& m,
+    std::span<const T> data)
+{
+    upload(b, std::size_t(m.base_vertex) * sizeof(T), as_bytes(data));
+}
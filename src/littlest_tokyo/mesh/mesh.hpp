@@ -1,14 +1,56 @@
 #pragma once
 
+#include "vertex_format.hpp"
+#include "../material/id.hpp"
+
 #include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/geometry/aabb.hpp"
+#include "common/glsl/solid_renderer/solid_variants.hpp"
+#include "common/mesh/vertex_cache.hpp"
+
+#include <cstdlib>
 
+// Ranges of a 'GeometryArena'.
 struct Mesh {
-    gl::BufferObj indices;
-    gl::BufferObj normals;
-    gl::BufferObj positions;
-    gl::BufferObj texcoords0;
+    // Bytes into the arena index buffer.
+    std::size_t index_offset = 0;
+    // Added to every index.
+    GLint base_vertex = 0;
+
+    PositionQuantization quantization;
 
     GLsizei draw_count = 0;
+    GLsizei vertex_count = 0;
     GLenum draw_mode;
     GLenum draw_type;
+
+    MaterialId material;
+    // 'has_normals', 'has_texcoords0' and 'base_color_texture' as imported,
+    // combined with the frame features to select a solid renderer variant.
+    glsl::SolidFeatures features = 0;
+
+    // Object space.
+    Aabb bounds;
+
+    // Import time optimization report.
+    mesh::VertexCacheStats vertex_cache_before;
+    mesh::VertexCacheStats vertex_cache_after;
 };
+
+inline
+GLenum index_type(std::size_t index_size) {
+    switch(index_size) {
+    case 1: return GL_UNSIGNED_BYTE;
+    case 2: return GL_UNSIGNED_SHORT;
+    default: return GL_UNSIGNED_INT;
+    }
+}
+
+inline
+std::size_t index_size(GLenum index_type) {
+    switch(index_type) {
+    case GL_UNSIGNED_BYTE: return 1;
+    case GL_UNSIGNED_SHORT: return 2;
+    default: return 4;
+    }
+}
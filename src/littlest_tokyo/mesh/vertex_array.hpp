@@ -1,73 +1,158 @@
 #pragma once
 
-#include "mesh.hpp"
+#include "geometry_arena.hpp"
+#include "vertex_format.hpp"
 
 #include "common/dependency/abstractgl_api_opengl.hpp"
 #include "common/dependency/glm.hpp"
 #include "common/glsl/solid_renderer/solid_renderer.hpp"
+#include "common/opengl/vertex_layout.hpp"
 
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+
+// 'VertexFormat::separate' reads normals, positions and texcoords0 from
+// bindings 0, 1 and 2, the compact formats read a single stream at 0.
+inline constexpr std::size_t vertex_binding_count = 3;
+
+// Buffers read by a shared vertex array, switched per draw source while its
+// attribute formats stay untouched.
+struct VertexBuffers {
+    GLuint indices = 0;
+    std::array<GLuint, vertex_binding_count> buffers = {};
+    std::array<GLintptr, vertex_binding_count> offsets = {};
+    std::array<GLsizei, vertex_binding_count> strides = {};
+
+    friend bool operator==(const VertexBuffers&, const VertexBuffers&) = default;
+};
+
+// Bindings 0, 1 and 2, one float buffer per attribute.
+inline constexpr auto separate_vertex_layout = VertexLayout<3, 3>{
+    .attributes = {{
+        {"a_normal", 0, GL_FLOAT, 3, false, 0, 0},
+        {"a_position", 1, GL_FLOAT, 3, false, 0, 1},
+        {"a_texcoords0", 2, GL_FLOAT, 3, false, 0, 2},
+    }},
+    .strides = {
+        GLsizei(sizeof(glm::vec3)),
+        GLsizei(sizeof(glm::vec3)),
+        GLsizei(sizeof(glm::vec3)),
+    },
+};
+
+inline constexpr auto interleaved_vertex_layout = VertexLayout<3>{
+    .attributes = {{
+        {"a_normal", 0, GL_SHORT, 2, true,
+            GLuint(offsetof(InterleavedVertex, normal))},
+        {"a_position", 1, GL_FLOAT, 3, false,
+            GLuint(offsetof(InterleavedVertex, position))},
+        {"a_texcoords0", 2, GL_HALF_FLOAT, 2, false,
+            GLuint(offsetof(InterleavedVertex, texcoords0))},
+    }},
+    .strides = {GLsizei(sizeof(InterleavedVertex))},
+};
+
+inline constexpr auto quantized_vertex_layout = VertexLayout<3>{
+    .attributes = {{
+        {"a_normal", 0, GL_SHORT, 2, true,
+            GLuint(offsetof(QuantizedVertex, normal))},
+        {"a_position", 1, GL_UNSIGNED_SHORT, 3, true,
+            GLuint(offsetof(QuantizedVertex, position))},
+        {"a_texcoords0", 2, GL_HALF_FLOAT, 2, false,
+            GLuint(offsetof(QuantizedVertex, texcoords0))},
+    }},
+    .strides = {GLsizei(sizeof(QuantizedVertex))},
+};
+
+static_assert(is_valid(separate_vertex_layout)
+    and matches(separate_vertex_layout, glsl::solid_inputs));
+static_assert(is_valid(interleaved_vertex_layout)
+    and matches(interleaved_vertex_layout, glsl::compact_solid_inputs));
+static_assert(is_valid(quantized_vertex_layout)
+    and matches(quantized_vertex_layout, glsl::compact_solid_inputs));
+
+// Attribute formats and bindings of 'format', no buffer.
 inline
-gl::VertexArrayObj
-vertex_array(
-    const Mesh& m,
-    const glsl::SolidRenderer& sr)
-{
+gl::VertexArrayObj vertex_array(VertexFormat format) {
     auto va = gl::VertexArrayObj();
-    auto binding_index_count = GLuint(0);
-    // Indices.
-    if(gl::GetNamedBufferParameter(m.indices, gl::BUFFER_SIZE) > 0) {
-        gl::VertexArrayElementBuffer(va, m.indices);
+    switch(format) {
+    case VertexFormat::separate:
+        set_layout(va, separate_vertex_layout);
+        break;
+    case VertexFormat::interleaved:
+        set_layout(va, interleaved_vertex_layout);
+        break;
+    case VertexFormat::quantized:
+        set_layout(va, quantized_vertex_layout);
+        break;
+    }
+    return va;
+}
+
+// Streams of 'format' in 'a'. Sizes are known on the CPU since import, so
+// nothing is queried back from the driver.
+inline
+VertexBuffers vertex_buffers(const GeometryArena& a, VertexFormat format) {
+    auto b = VertexBuffers();
+    if(a.index_size > 0) {
+        b.indices = a.indices;
+    }
+    if(a.vertex_count == 0) {
+        return b;
     }
-    // Normals.
-    if(gl::GetNamedBufferParameter(m.normals, gl::BUFFER_SIZE) > 0) {
-        auto bindingindex = binding_index_count++;
-        gl::VertexArrayAttribFormat(va,
-            sr.normal,
-            3, GL_FLOAT,
-            GL_FALSE, 0);
-        gl::VertexArrayVertexBuffer(va,
-            bindingindex,
-            m.normals,
-            0, sizeof(glm::vec3));
-        gl::VertexArrayAttribBinding(va,
-            sr.normal,
-            bindingindex);
-        gl::EnableVertexArrayAttrib(va,
-            sr.normal);
+    switch(format) {
+    case VertexFormat::separate:
+        b.buffers = {a.normals, a.positions, a.texcoords0};
+        b.strides = separate_vertex_layout.strides;
+        break;
+    case VertexFormat::interleaved:
+        b.buffers[0] = a.interleaved;
+        b.strides[0] = interleaved_vertex_layout.strides[0];
+        break;
+    case VertexFormat::quantized:
+        b.buffers[0] = a.quantized;
+        b.strides[0] = quantized_vertex_layout.strides[0];
+        break;
+    }
+    return b;
+}
+
+// One vertex array per 'VertexFormat', shared by every draw source with that
+// layout: the whole geometry arena and the gizmos.
+struct VertexArrayCache {
+    std::array<gl::VertexArrayObj, vertex_format_count> vertex_arrays;
+    // Currently bound to each vertex array.
+    std::array<VertexBuffers, vertex_format_count> bound;
+    // Buffer switches, the others were skipped as redundant.
+    std::size_t switch_count = 0;
+};
+
+inline
+VertexArrayCache vertex_array_cache() {
+    auto c = VertexArrayCache();
+    for(std::size_t f = 0; f < vertex_format_count; ++f) {
+        c.vertex_arrays[f] = vertex_array(VertexFormat(f));
     }
-    // Positions.
-    if(gl::GetNamedBufferParameter(m.positions, gl::BUFFER_SIZE) > 0) { 
-        auto bindingindex = binding_index_count++;
-        gl::VertexArrayAttribFormat(va,
-            sr.position,
-            3, GL_FLOAT,
-            GL_FALSE, 0);
-        gl::VertexArrayVertexBuffer(va,
-            bindingindex,
-            m.positions,
-            0, sizeof(glm::vec3));
-        gl::VertexArrayAttribBinding(va,
-            sr.position,
-            bindingindex);
-        gl::EnableVertexArrayAttrib(va,
-            sr.position);
+    return c;
+}
+
+// Points the vertex array of 'format' at 'b' unless it already is, then
+// returns it for binding.
+inline
+GLuint bind_buffers(
+    VertexArrayCache& c,
+    VertexFormat format,
+    const VertexBuffers& b)
+{
+    auto& va = c.vertex_arrays[std::size_t(format)];
+    auto& bound = c.bound[std::size_t(format)];
+    if(bound != b) {
+        glVertexArrayVertexBuffers(va, 0, GLsizei(vertex_binding_count),
+            b.buffers.data(), b.offsets.data(), b.strides.data());
+        glVertexArrayElementBuffer(va, b.indices);
+        bound = b;
+        c.switch_count += 1;
     }
-	// Texcoords0.
-	if(gl::GetNamedBufferParameter(m.texcoords0, gl::BUFFER_SIZE) > 0) {
-		auto bindingindex = binding_index_count++;
-		gl::VertexArrayVertexBuffer(va,
-			bindingindex,
-			m.texcoords0,
-			0, sizeof(glm::vec3));
-		gl::VertexArrayAttribFormat(va,
-			sr.texcoords0,
-			3, GL_FLOAT,
-			GL_FALSE, 0);
-		gl::VertexArrayAttribBinding(va,
-			sr.texcoords0,
-			bindingindex);
-		gl::EnableVertexArrayAttrib(va,
-			sr.texcoords0);
-	}
     return va;
 }
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "common/dependency/glm.hpp"
+#include "common/geometry/aabb.hpp"
+#include "common/mesh/vertex_quantization.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+
+enum class VertexFormat {
+    // One float buffer per attribute, 3 components each.
+    separate,
+    // Float positions, octahedral normals and half float texcoords.
+    interleaved,
+    // Same as interleaved with 16 bit positions relative to the mesh bounds.
+    quantized,
+};
+
+inline constexpr std::size_t vertex_format_count = 3;
+
+inline constexpr const char* vertex_format_names[vertex_format_count] = {
+    "Separate",
+    "Interleaved",
+    "Quantized",
+};
+
+struct InterleavedVertex {
+    float position[3];
+    std::int16_t normal[2];
+    std::uint16_t texcoords0[2];
+};
+
+static_assert(sizeof(InterleavedVertex) == 20);
+
+struct QuantizedVertex {
+    // Last component is padding.
+    std::uint16_t position[4];
+    std::int16_t normal[2];
+    std::uint16_t texcoords0[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 16);
+
+// Positions are dequantized as 'offset + scale * position'.
+struct PositionQuantization {
+    glm::vec3 offset = glm::vec3(0.f);
+    glm::vec3 scale = glm::vec3(1.f);
+};
+
+inline
+PositionQuantization position_quantization(const Aabb& bounds) {
+    auto q = PositionQuantization();
+    if(not is_empty(bounds)) {
+        q.offset = bounds.min;
+        q.scale = extent(bounds);
+        for(int i = 0; i < 3; ++i) {
+            if(q.scale[i] == 0.f) {
+                q.scale[i] = 1.f;
+            }
+        }
+    }
+    return q;
+}
+
+inline
+InterleavedVertex interleaved_vertex(
+    const glm::vec3& normal,
+    const glm::vec3& position,
+    const glm::vec3& texcoords0)
+{
+    auto v = InterleavedVertex();
+    v.position[0] = position.x;
+    v.position[1] = position.y;
+    v.position[2] = position.z;
+    auto n = mesh::octahedral_snorm16(normal.x, normal.y, normal.z);
+    v.normal[0] = n[0];
+    v.normal[1] = n[1];
+    v.texcoords0[0] = mesh::half(texcoords0.x);
+    v.texcoords0[1] = mesh::half(texcoords0.y);
+    return v;
+}
+
+inline
+QuantizedVertex quantized_vertex(
+    const glm::vec3& normal,
+    const glm::vec3& position,
+    const glm::vec3& texcoords0,
+    const PositionQuantization& q)
+{
+    auto v = QuantizedVertex();
+    auto p = (position - q.offset) / q.scale;
+    v.position[0] = mesh::unorm16(p.x);
+    v.position[1] = mesh::unorm16(p.y);
+    v.position[2] = mesh::unorm16(p.z);
+    auto n = mesh::octahedral_snorm16(normal.x, normal.y, normal.z);
+    v.normal[0] = n[0];
+    v.normal[1] = n[1];
+    v.texcoords0[0] = mesh::half(texcoords0.x);
+    v.texcoords0[1] = mesh::half(texcoords0.y);
+    return v;
+}
+
+// Bytes per vertex, 'attribute_count' is only used by the separate format.
+inline
+std::size_t vertex_size(VertexFormat f, std::size_t attribute_count) {
+    switch(f) {
+    case VertexFormat::separate: return attribute_count * sizeof(glm::vec3);
+    case VertexFormat::interleaved: return sizeof(InterleavedVertex);
+    case VertexFormat::quantized: return sizeof(QuantizedVertex);
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/dependency/glm.hpp"
+
+// 'Frame' in 'solid_renderer/shader.vert', std140.
+struct FrameData {
+    glm::mat4 world_to_view;
+    glm::mat4 view_to_clip;
+    glm::mat4 world_to_clip;
+};
+
+static_assert(sizeof(FrameData) == 192);
+
+// Uniform buffer written once per frame.
+struct FrameUniforms {
+    gl::BufferObj buffer;
+};
+
+inline
+FrameUniforms frame_uniforms() {
+    auto fu = FrameUniforms();
+    glNamedBufferStorage(fu.buffer, GLsizeiptr(sizeof(FrameData)), nullptr,
+        GL_DYNAMIC_STORAGE_BIT);
+    return fu;
+}
+
+// Also binds it to uniform buffer binding 0.
+inline
+void upload(const FrameUniforms& fu, const FrameData& data) {
+    glNamedBufferSubData(fu.buffer, 0, GLsizeiptr(sizeof(FrameData)), &data);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, fu.buffer);
+}
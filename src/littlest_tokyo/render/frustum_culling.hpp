@@ -0,0 +1,100 @@
+#pragma once
+
+#include "../mesh/mesh.hpp"
+#include "../scene_graph/scene_graph.hpp"
+
+#include "common/dependency/glm.hpp"
+#include "common/geometry/aabb.hpp"
+#include "common/geometry/bvh4.hpp"
+#include "common/geometry/frustum.hpp"
+#include "common/time/clock.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+// BVH over the world bounds of the scene nodes drawing meshes.
+struct FrustumCulling {
+    bool is_enabled = true;
+
+    // Scene node of each BVH item.
+    std::vector<std::uint32_t> nodes;
+    // World space, per BVH item.
+    std::vector<Aabb> bounds;
+    Bvh4 bvh;
+
+    // Per scene node, written by 'cull'.
+    std::vector<std::uint8_t> visible;
+
+    std::size_t visible_count = 0;
+    std::size_t culled_count = 0;
+    std::size_t node_tests = 0;
+    float seconds = 0.f;
+};
+
+inline
+void compute_world_bounds(
+    FrustumCulling& fc,
+    const SceneGraph& sg,
+    std::span<const Mesh> meshes)
+{
+    for(std::size_t i = 0; i < size(fc.nodes); ++i) {
+        auto ni = fc.nodes[i];
+        auto b = Aabb();
+        for(auto mi : ::meshes(sg, ni)) {
+            extend(b, meshes[mi].bounds);
+        }
+        fc.bounds[i] = transformed(b, sg.world_transforms[ni]);
+    }
+}
+
+inline
+FrustumCulling frustum_culling(
+    const SceneGraph& sg,
+    std::span<const Mesh> meshes)
+{
+    auto fc = FrustumCulling();
+    for(std::size_t ni = 0; ni < node_count(sg); ++ni) {
+        if(sg.mesh_counts[ni] > 0) {
+            fc.nodes.push_back(std::uint32_t(ni));
+        }
+    }
+    fc.bounds.resize(size(fc.nodes));
+    compute_world_bounds(fc, sg, meshes);
+    fc.bvh = bvh4(fc.bounds);
+    fc.visible.assign(node_count(sg), 1);
+    return fc;
+}
+
+// After world transforms changed, the BVH topology is kept.
+inline
+void refit(
+    FrustumCulling& fc,
+    const SceneGraph& sg,
+    std::span<const Mesh> meshes)
+{
+    compute_world_bounds(fc, sg, meshes);
+    refit(fc.bvh, fc.bounds);
+}
+
+inline
+void cull(FrustumCulling& fc, const glm::mat4& world_to_clip) {
+    auto clock = Clock();
+    if(fc.is_enabled) {
+        std::fill(begin(fc.visible), end(fc.visible), std::uint8_t(0));
+        fc.visible_count = 0;
+        auto stats = cull(fc.bvh, frustum(world_to_clip), [&](std::uint32_t item) {
+            fc.visible[fc.nodes[item]] = 1;
+            fc.visible_count += 1;
+        });
+        fc.node_tests = stats.node_tests;
+    } else {
+        std::fill(begin(fc.visible), end(fc.visible), std::uint8_t(1));
+        fc.visible_count = size(fc.nodes);
+        fc.node_tests = 0;
+    }
+    fc.culled_count = size(fc.nodes) - fc.visible_count;
+    fc.seconds = clock.restart().count();
+}
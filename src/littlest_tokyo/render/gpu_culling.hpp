@@ -0,0 +1,298 @@
+#pragma once
+
+#include "multi_draw.hpp"
+#include "object_ring.hpp"
+#include "../material/material_table.hpp"
+#include "../mesh/mesh.hpp"
+#include "../scene_graph/scene_graph.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/dependency/glm.hpp"
+#include "common/geometry/aabb.hpp"
+#include "common/geometry/frustum.hpp"
+#include "common/glsl/gpu_culling/gpu_culling.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+// 'Instance' in 'gpu_culling/cull.comp', std430.
+struct GpuInstance {
+    glm::mat4 object_to_world;
+    glm::vec4 bounds_min;
+    glm::vec4 bounds_max;
+    glm::vec4 position_offset;
+    // 'w' is the index in 'MaterialTable'.
+    glm::vec4 position_scale;
+    GLuint count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint batch;
+};
+
+static_assert(sizeof(GpuInstance) == 144);
+
+// Every mesh instance of the scene is tested by a compute shader, against the
+// frustum and the depth pyramid of the previous frame, which compacts the
+// visible ones into indirect commands. The CPU records a dispatch and one
+// 'glMultiDrawElementsIndirectCount' per batch whatever the scene size,
+// batches being split by primitive mode, index type and mesh features.
+struct GpuCulling {
+    bool use_depth_pyramid = true;
+    // Draws the culled instances over the frame.
+    bool debug_view = false;
+
+    // Static, transforms and bounds are rewritten by 'refit'.
+    std::vector<GpuInstance> instances;
+    // Ranges of each command list, 'count' is the maximum.
+    std::vector<MultiDrawBatch> batches;
+
+    gl::BufferObj instance_buffer;
+    // 'ObjectData' per instance, written by the compute shader.
+    gl::BufferObj draw_buffer;
+    // Visible commands, then culled commands.
+    gl::BufferObj command_buffer;
+    // Draw count per batch of each command list.
+    gl::BufferObj count_buffer;
+    gl::BufferObj batch_first_buffer;
+
+    // Farthest depth of the previous frame, 'GL_R32F' with all levels.
+    gl::TextureObject depth_pyramid;
+    int depth_pyramid_width = 0;
+    int depth_pyramid_height = 0;
+    int depth_pyramid_level_count = 0;
+    glm::mat4 depth_pyramid_world_to_clip = glm::mat4(1.f);
+    bool has_depth_pyramid = false;
+};
+
+inline
+void compute_instances(
+    GpuCulling& gc,
+    const SceneGraph& sg,
+    std::span<const Mesh> meshes)
+{
+    auto i = std::size_t(0);
+    for(std::size_t ni = 0; ni < node_count(sg); ++ni) {
+        auto& world = sg.world_transforms[ni];
+        for(auto mi : ::meshes(sg, ni)) {
+            auto& m = meshes[mi];
+            if(m.draw_count == 0) {
+                continue;
+            }
+            auto b = transformed(m.bounds, world);
+            auto& instance = gc.instances[i++];
+            instance.object_to_world = world;
+            instance.bounds_min = glm::vec4(b.min, 0.f);
+            instance.bounds_max = glm::vec4(b.max, 0.f);
+        }
+    }
+}
+
+inline
+GpuCulling gpu_culling(
+    const SceneGraph& sg,
+    std::span<const Mesh> meshes)
+{
+    auto gc = GpuCulling();
+    for(std::size_t ni = 0; ni < node_count(sg); ++ni) {
+        for(auto mi : ::meshes(sg, ni)) {
+            auto& m = meshes[mi];
+            if(m.draw_count == 0) {
+                continue;
+            }
+            auto b = std::size_t(0);
+            while(b < size(gc.batches)
+                and (gc.batches[b].mode != m.draw_mode
+                    or gc.batches[b].type != m.draw_type
+                    or gc.batches[b].features != m.features))
+            {
+                ++b;
+            }
+            if(b == size(gc.batches)) {
+                gc.batches.push_back({m.draw_mode, m.draw_type, m.features});
+            }
+            gc.batches[b].count += 1;
+            gc.instances.push_back({
+                .object_to_world = glm::mat4(1.f),
+                .bounds_min = glm::vec4(0.f),
+                .bounds_max = glm::vec4(0.f),
+                .position_offset = glm::vec4(m.quantization.offset, 0.f),
+                .position_scale = glm::vec4(m.quantization.scale,
+                    float(material_index(m.material))),
+                .count = GLuint(m.draw_count),
+                .first_index = GLuint(m.index_offset / index_size(m.draw_type)),
+                .base_vertex = m.base_vertex,
+                .batch = GLuint(b),
+            });
+        }
+    }
+    compute_instances(gc, sg, meshes);
+    auto batch_firsts = std::vector<GLuint>();
+    auto first = std::size_t(0);
+    for(auto& b : gc.batches) {
+        b.first = first;
+        first += b.count;
+        batch_firsts.push_back(GLuint(b.first));
+    }
+    { // Buffers.
+        // Never empty, zero sized storage is an error.
+        auto instance_count = std::max<std::size_t>(size(gc.instances), 1);
+        auto batch_count = std::max<std::size_t>(size(gc.batches), 1);
+        glNamedBufferStorage(gc.instance_buffer,
+            GLsizeiptr(instance_count * sizeof(GpuInstance)),
+            gc.instances.data(), GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferStorage(gc.draw_buffer,
+            GLsizeiptr(instance_count * sizeof(ObjectData)), nullptr, 0);
+        glNamedBufferStorage(gc.command_buffer,
+            GLsizeiptr(2 * instance_count * sizeof(DrawElementsIndirectCommand)),
+            nullptr, 0);
+        glNamedBufferStorage(gc.count_buffer,
+            GLsizeiptr(2 * batch_count * sizeof(GLuint)), nullptr, 0);
+        batch_firsts.resize(batch_count);
+        glNamedBufferStorage(gc.batch_first_buffer,
+            GLsizeiptr(batch_count * sizeof(GLuint)), batch_firsts.data(), 0);
+    }
+    return gc;
+}
+
+// After world transforms changed.
+inline
+void refit(
+    GpuCulling& gc,
+    const SceneGraph& sg,
+    std::span<const Mesh> meshes)
+{
+    compute_instances(gc, sg, meshes);
+    if(not gc.instances.empty()) {
+        glNamedBufferSubData(gc.instance_buffer, 0,
+            GLsizeiptr(size(gc.instances) * sizeof(GpuInstance)),
+            gc.instances.data());
+    }
+}
+
+// Writes the command lists and 'ObjectData' of every instance.
+inline
+void cull(
+    GpuCulling& gc,
+    const glsl::GpuCulling& programs,
+    const glm::mat4& world_to_clip,
+    bool use_quantization)
+{
+    if(gc.instances.empty()) {
+        return;
+    }
+    auto zero = GLuint(0);
+    glClearNamedBufferData(gc.count_buffer,
+        GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    auto& p = programs.cull;
+    auto f = frustum(world_to_clip);
+    glProgramUniform1ui(p, programs.instance_count, GLuint(size(gc.instances)));
+    glProgramUniform1ui(p, programs.batch_count, GLuint(size(gc.batches)));
+    glProgramUniform4fv(p, programs.frustum_planes, 6, &f.planes[0][0]);
+    glProgramUniform1i(p, programs.use_depth_pyramid,
+        gc.use_depth_pyramid and gc.has_depth_pyramid);
+    glProgramUniformMatrix4fv(p, programs.depth_pyramid_world_to_clip,
+        1, GL_FALSE, &gc.depth_pyramid_world_to_clip[0][0]);
+    glProgramUniform1i(p, programs.use_quantization, use_quantization);
+    glProgramUniform1i(p, programs.debug_view, gc.debug_view);
+
+    gl::UseProgram(p);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gc.draw_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, gc.instance_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, gc.command_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gc.count_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, gc.batch_first_buffer);
+    if(gc.has_depth_pyramid) {
+        glBindTextureUnit(0, gc.depth_pyramid);
+    }
+    glDispatchCompute(GLuint((size(gc.instances) + 63) / 64), 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    glBindTextureUnit(0, 0);
+}
+
+// Expects the geometry vertex array to be bound. 'use_features' binds the
+// program of each batch from its mesh features, a batch is skipped when it
+// returns false.
+// 'list' 0 draws the visible instances, 1 the culled ones.
+// Returns the number of draw calls.
+template<typename UseFeatures>
+std::size_t draw(
+    const GpuCulling& gc,
+    UseFeatures use_features,
+    std::size_t list = 0)
+{
+    if(gc.instances.empty()) {
+        return 0;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gc.command_buffer);
+    glBindBuffer(GL_PARAMETER_BUFFER, gc.count_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gc.draw_buffer);
+    auto draw_calls = std::size_t(0);
+    for(std::size_t b = 0; b < size(gc.batches); ++b) {
+        auto& batch = gc.batches[b];
+        if(not use_features(batch.features)) {
+            continue;
+        }
+        auto indirect = reinterpret_cast<const void*>(
+            (list * size(gc.instances) + batch.first)
+            * sizeof(DrawElementsIndirectCommand));
+        auto draw_count = GLintptr((list * size(gc.batches) + b) * sizeof(GLuint));
+        // Core since 4.6, Mesa exposes the extension on older contexts.
+        if(GLEW_VERSION_4_6) {
+            glMultiDrawElementsIndirectCount(batch.mode, batch.type,
+                indirect, draw_count, GLsizei(batch.count), 0);
+        } else {
+            glMultiDrawElementsIndirectCountARB(batch.mode, batch.type,
+                indirect, draw_count, GLsizei(batch.count), 0);
+        }
+        draw_calls += 1;
+    }
+    glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    return draw_calls;
+}
+
+// Builds the pyramid tested by the next 'cull' from the depth of this frame.
+inline
+void build_depth_pyramid(
+    GpuCulling& gc,
+    const glsl::GpuCulling& programs,
+    GLuint depth_texture,
+    int width,
+    int height,
+    const glm::mat4& world_to_clip)
+{
+    if(width != gc.depth_pyramid_width or height != gc.depth_pyramid_height) {
+        gc.depth_pyramid_width = width;
+        gc.depth_pyramid_height = height;
+        gc.depth_pyramid_level_count = 1;
+        while((std::max(width, height) >> gc.depth_pyramid_level_count) > 0) {
+            gc.depth_pyramid_level_count += 1;
+        }
+        gc.depth_pyramid = gl::Texture(GL_TEXTURE_2D);
+        glTextureStorage2D(gc.depth_pyramid, gc.depth_pyramid_level_count,
+            GL_R32F, width, height);
+        glTextureParameteri(gc.depth_pyramid, GL_TEXTURE_MIN_FILTER,
+            GL_NEAREST_MIPMAP_NEAREST);
+        glTextureParameteri(gc.depth_pyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    auto& p = programs.depth_pyramid;
+    gl::UseProgram(p);
+    for(int level = 0; level < gc.depth_pyramid_level_count; ++level) {
+        // Level 0 copies the depth texture.
+        glBindTextureUnit(0, (level == 0) ? depth_texture : GLuint(gc.depth_pyramid));
+        glProgramUniform1i(p, programs.source_level, std::max(level - 1, 0));
+        glBindImageTexture(0, gc.depth_pyramid, level,
+            GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        auto w = std::max(width >> level, 1);
+        auto h = std::max(height >> level, 1);
+        glDispatchCompute(GLuint((w + 7) / 8), GLuint((h + 7) / 8), 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    glBindTextureUnit(0, 0);
+    gc.depth_pyramid_world_to_clip = world_to_clip;
+    gc.has_depth_pyramid = true;
+}
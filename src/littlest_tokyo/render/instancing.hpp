@@ -0,0 +1,121 @@
+#pragma once
+
+#include "multi_draw.hpp"
+#include "object_ring.hpp"
+#include "../mesh/id.hpp"
+#include "../mesh/mesh.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/dependency/glm.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+// Mesh instances sharing a 'MeshId', drawn by one instanced call.
+struct InstanceGroup {
+    MeshId mesh;
+    std::size_t first = 0;
+    std::size_t count = 0;
+};
+
+// Repeated meshes are collapsed into instanced draws, with the object data of
+// every instance in 'ObjectRing', indexed by base instance plus instance.
+struct Instancing {
+    std::vector<InstanceGroup> groups;
+    // Grouped by mesh after 'upload'.
+    std::vector<ObjectData> objects;
+    // Of 'objects' in the ring.
+    GLuint first_object = 0;
+
+    // In push order.
+    std::vector<MeshId> pushed_meshes;
+    std::vector<ObjectData> pushed_objects;
+    // Per mesh, reused by 'upload'.
+    std::vector<std::size_t> mesh_firsts;
+
+    // Draw calls saved compared to one call per instance.
+    std::size_t collapsed_draw_count = 0;
+};
+
+inline
+void clear(Instancing& in) {
+    in.groups.clear();
+    in.objects.clear();
+    in.pushed_meshes.clear();
+    in.pushed_objects.clear();
+}
+
+inline
+void push(
+    Instancing& in,
+    MeshId mi,
+    const Mesh& m,
+    const ObjectData& object)
+{
+    if(m.draw_count == 0) {
+        return;
+    }
+    in.pushed_meshes.push_back(mi);
+    in.pushed_objects.push_back(object);
+}
+
+// Counting sort of the pushed objects by mesh, then written to 'ring'.
+inline
+void upload(
+    Instancing& in,
+    std::size_t mesh_count,
+    ObjectRing& ring)
+{
+    in.mesh_firsts.assign(mesh_count + 1, 0);
+    for(auto mi : in.pushed_meshes) {
+        in.mesh_firsts[mi + 1] += 1;
+    }
+    for(std::size_t mi = 0; mi < mesh_count; ++mi) {
+        auto count = in.mesh_firsts[mi + 1];
+        in.mesh_firsts[mi + 1] += in.mesh_firsts[mi];
+        if(count > 0) {
+            in.groups.push_back({MeshId(mi), in.mesh_firsts[mi], count});
+        }
+    }
+    in.objects.resize(size(in.pushed_objects));
+    for(std::size_t i = 0; i < size(in.pushed_objects); ++i) {
+        in.objects[in.mesh_firsts[in.pushed_meshes[i]]++]
+            = in.pushed_objects[i];
+    }
+    in.collapsed_draw_count = size(in.objects) - size(in.groups);
+    in.first_object = write(ring, in.objects);
+}
+
+// Expects the geometry vertex array and the objects written by 'upload' to
+// be bound. 'use_features' binds the program of each group from its mesh
+// features, a group is skipped when it returns false.
+// Returns the number of draw calls.
+template<typename UseFeatures>
+std::size_t draw(
+    const Instancing& in,
+    std::span<const Mesh> meshes,
+    UseFeatures use_features)
+{
+    if(in.groups.empty()) {
+        return 0;
+    }
+    auto draw_calls = std::size_t(0);
+    for(auto& g : in.groups) {
+        auto& m = meshes[g.mesh];
+        if(not use_features(m.features)) {
+            continue;
+        }
+        // The base instance offsets 'gl_BaseInstanceARB' to the group.
+        glDrawElementsInstancedBaseVertexBaseInstance(m.draw_mode,
+            m.draw_count,
+            m.draw_type,
+            reinterpret_cast<const void*>(m.index_offset),
+            GLsizei(g.count),
+            m.base_vertex,
+            in.first_object + GLuint(g.first));
+        draw_calls += 1;
+    }
+    return draw_calls;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "object_ring.hpp"
+#include "../mesh/mesh.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/dependency/glm.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+// Layout of 'glMultiDrawElementsIndirect' commands.
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20);
+
+// Commands sharing a primitive mode, an index type and mesh features,
+// submitted by one call.
+struct MultiDrawBatch {
+    GLenum mode;
+    GLenum type;
+    // Of the meshes, see 'Mesh::features'.
+    glsl::SolidFeatures features = 0;
+    std::size_t first = 0;
+    std::size_t count = 0;
+};
+
+// Whole scene submission: one indirect command per mesh instance, with its
+// object data in 'ObjectRing' at the index of its base instance.
+struct MultiDraw {
+    std::vector<MultiDrawBatch> batches;
+    // Grouped by batch after 'upload'.
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<ObjectData> objects;
+
+    // Batch of each pushed command, in push order.
+    std::vector<std::uint32_t> command_batches;
+    std::vector<DrawElementsIndirectCommand> pushed_commands;
+
+    gl::BufferObj command_buffer;
+    std::size_t command_capacity = 0;
+};
+
+inline
+void clear(MultiDraw& md) {
+    md.batches.clear();
+    md.commands.clear();
+    md.objects.clear();
+    md.command_batches.clear();
+    md.pushed_commands.clear();
+}
+
+inline
+void push(
+    MultiDraw& md,
+    const Mesh& m,
+    const ObjectData& object)
+{
+    if(m.draw_count == 0) {
+        return;
+    }
+    auto b = std::size_t(0);
+    while(b < size(md.batches)
+        and (md.batches[b].mode != m.draw_mode
+            or md.batches[b].type != m.draw_type
+            or md.batches[b].features != m.features))
+    {
+        ++b;
+    }
+    if(b == size(md.batches)) {
+        md.batches.push_back({m.draw_mode, m.draw_type, m.features});
+    }
+    md.batches[b].count += 1;
+    md.command_batches.push_back(std::uint32_t(b));
+    md.pushed_commands.push_back({
+        .count = GLuint(m.draw_count),
+        .instance_count = 1,
+        .first_index = GLuint(m.index_offset / index_size(m.draw_type)),
+        .base_vertex = m.base_vertex,
+        .base_instance = GLuint(size(md.objects)),
+    });
+    md.objects.push_back(object);
+}
+
+// Grows 'b' geometrically, its content is replaced by 'data'.
+template<typename T>
+void upload_stream(
+    gl::BufferObj& b,
+    std::size_t& capacity,
+    std::span<const T> data)
+{
+    if(size(data) > capacity) {
+        capacity = std::max(size(data), 2 * capacity);
+        b = gl::BufferObj();
+        glNamedBufferStorage(b, GLsizeiptr(capacity * sizeof(T)), nullptr,
+            GL_DYNAMIC_STORAGE_BIT);
+    }
+    if(not data.empty()) {
+        glNamedBufferSubData(b, 0, GLsizeiptr(size(data) * sizeof(T)),
+            data.data());
+    }
+}
+
+// Groups commands by batch, uploads commands and writes objects to 'ring'.
+inline
+void upload(MultiDraw& md, ObjectRing& ring) {
+    auto first_object = write(ring, md.objects);
+    auto first = std::size_t(0);
+    for(auto& b : md.batches) {
+        b.first = first;
+        first += b.count;
+    }
+    md.commands.resize(size(md.pushed_commands));
+    auto next = std::vector<std::size_t>(size(md.batches));
+    for(std::size_t b = 0; b < size(md.batches); ++b) {
+        next[b] = md.batches[b].first;
+    }
+    for(std::size_t i = 0; i < size(md.pushed_commands); ++i) {
+        auto& c = md.commands[next[md.command_batches[i]]++];
+        c = md.pushed_commands[i];
+        c.base_instance += first_object;
+    }
+    upload_stream(md.command_buffer, md.command_capacity,
+        std::span<const DrawElementsIndirectCommand>(md.commands));
+}
+
+// Expects the geometry vertex array and the objects written by 'upload' to
+// be bound. 'use_features' binds the program of each batch from its mesh
+// features, a batch is skipped when it returns false.
+// Returns the number of draw calls.
+template<typename UseFeatures>
+std::size_t draw(const MultiDraw& md, UseFeatures use_features) {
+    if(md.commands.empty()) {
+        return 0;
+    }
+    auto draw_calls = std::size_t(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, md.command_buffer);
+    for(auto& b : md.batches) {
+        if(not use_features(b.features)) {
+            continue;
+        }
+        glMultiDrawElementsIndirect(b.mode, b.type,
+            reinterpret_cast<const void*>(
+                b.first * sizeof(DrawElementsIndirectCommand)),
+            GLsizei(b.count), 0);
+        draw_calls += 1;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    return draw_calls;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "../mesh/vertex_format.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/dependency/glm.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+// 'Object' in 'solid_renderer/shader.vert', std430.
+struct ObjectData {
+    glm::mat4 object_to_world;
+    // Inverse transpose of 'object_to_world', for normals.
+    glm::mat4 object_to_world_normal;
+    // Identity unless positions are quantized.
+    glm::vec4 position_offset;
+    // 'w' is the index in 'MaterialTable'.
+    glm::vec4 position_scale;
+};
+
+static_assert(sizeof(ObjectData) == 160);
+
+inline
+ObjectData object_data(
+    const glm::mat4& object_to_world,
+    const PositionQuantization& q = PositionQuantization(),
+    std::uint32_t material = 0)
+{
+    return {
+        .object_to_world = object_to_world,
+        .object_to_world_normal = glm::mat4(
+            glm::transpose(glm::inverse(glm::mat3(object_to_world)))),
+        .position_offset = glm::vec4(q.offset, 0.f),
+        .position_scale = glm::vec4(q.scale, float(material)),
+    };
+}
+
+inline constexpr std::size_t object_ring_region_count = 3;
+
+// Persistently mapped storage buffer with a region per frame in flight, the
+// object data of a frame is copied in bulk and indexed by base instance.
+struct ObjectRing {
+    gl::BufferObj buffer;
+    ObjectData* mapped = nullptr;
+    // Objects per region.
+    std::size_t capacity = 0;
+    std::size_t region = 0;
+    // Objects written to the current region.
+    std::size_t used = 0;
+    // Signaled when the GPU is done with each region.
+    std::array<GLsync, object_ring_region_count> fences = {};
+    std::size_t grow_count = 0;
+};
+
+inline
+void release_fences(ObjectRing& ring) {
+    for(auto& fence : ring.fences) {
+        if(fence != nullptr) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+}
+
+// Objects already written to the current region keep their indices, so the
+// base instances handed out earlier in the frame stay valid for the draws
+// still to be submitted. Previous storage stays alive until the draws
+// reading it completed.
+inline
+void allocate(ObjectRing& ring, std::size_t capacity) {
+    // Regions must start at the storage buffer offset alignment.
+    auto alignment = GLint(256);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    auto granularity = std::size_t(alignment)
+        / std::gcd(std::size_t(alignment), sizeof(ObjectData));
+    capacity = std::max<std::size_t>(capacity, 1);
+    capacity = (capacity + granularity - 1) / granularity * granularity;
+    release_fences(ring);
+    auto flags = GLbitfield(
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+    auto bytes = GLsizeiptr(object_ring_region_count * capacity * sizeof(ObjectData));
+    auto buffer = gl::BufferObj();
+    glNamedBufferStorage(buffer, bytes, nullptr, flags);
+    auto mapped = static_cast<ObjectData*>(
+        glMapNamedBufferRange(buffer, 0, bytes, flags));
+    if(mapped == nullptr) {
+        throw std::runtime_error("Failed to map the object ring.");
+    }
+    if(ring.used > 0) {
+        // On the GPU, the mapping is write only. Coherent writes are visible
+        // to the copy.
+        glCopyNamedBufferSubData(ring.buffer, buffer,
+            GLintptr(ring.region * ring.capacity * sizeof(ObjectData)),
+            GLintptr(ring.region * capacity * sizeof(ObjectData)),
+            GLsizeiptr(ring.used * sizeof(ObjectData)));
+    }
+    ring.buffer = std::move(buffer);
+    ring.mapped = mapped;
+    ring.capacity = capacity;
+}
+
+inline
+ObjectRing object_ring(std::size_t capacity) {
+    auto ring = ObjectRing();
+    allocate(ring, capacity);
+    return ring;
+}
+
+// Moves to the next region, waiting for the GPU to be done with it.
+inline
+void begin_frame(ObjectRing& ring) {
+    ring.region = (ring.region + 1) % object_ring_region_count;
+    ring.used = 0;
+    auto& fence = ring.fences[ring.region];
+    if(fence != nullptr) {
+        while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000)
+            == GL_TIMEOUT_EXPIRED)
+        {}
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+// After the last draw reading the current region.
+inline
+void end_frame(ObjectRing& ring) {
+    ring.fences[ring.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// Copies 'objects' to the current region and binds the region to storage
+// buffer binding 0. Returns the index of the first object in the region,
+// the base instance of its draws.
+inline
+GLuint write(ObjectRing& ring, std::span<const ObjectData> objects) {
+    if(ring.used + size(objects) > ring.capacity) {
+        allocate(ring, std::max(2 * ring.capacity, ring.used + size(objects)));
+        ring.grow_count += 1;
+    }
+    auto first = ring.used;
+    auto region_first = ring.region * ring.capacity;
+    if(not objects.empty()) {
+        std::memcpy(ring.mapped + region_first + first, objects.data(),
+            size(objects) * sizeof(ObjectData));
+    }
+    ring.used += size(objects);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, ring.buffer,
+        GLintptr(region_first * sizeof(ObjectData)),
+        GLsizeiptr(ring.capacity * sizeof(ObjectData)));
+    return GLuint(first);
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "frustum_culling.hpp"
+#include "../mesh/mesh.hpp"
+#include "../scene_cache/scene_cache.hpp"
+#include "../scene_graph/scene_graph.hpp"
+
+#include "common/dependency/glm.hpp"
+#include "common/geometry/aabb.hpp"
+#include "common/occlusion/depth_buffer.hpp"
+#include "common/time/clock.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// Largest mesh instances of the scene rasterized on the CPU, the visible
+// nodes of 'FrustumCulling' are then tested against the depth pyramid.
+struct OcclusionCulling {
+    bool is_enabled = true;
+
+    occlusion::DepthBuffer depth = occlusion::depth_buffer(320, 180);
+
+    // Vertices of each occluder mesh, in object space, and the node placing
+    // them. Picked once at load, moved along with their nodes by 'refit'.
+    struct Occluder {
+        std::uint32_t node;
+        std::uint32_t first_position;
+        std::uint32_t position_count;
+    };
+    std::vector<Occluder> occluders;
+    std::vector<glm::vec3> occluder_object_positions;
+    // World space.
+    std::vector<glm::vec4> occluder_positions;
+    std::vector<std::uint32_t> occluder_indices;
+    // Per frame.
+    std::vector<glm::vec4> occluder_clip_positions;
+
+    std::size_t rasterized_count = 0;
+    std::size_t occluded_count = 0;
+    float rasterize_seconds = 0.f;
+    float test_seconds = 0.f;
+};
+
+// Moves the occluders to the world transforms of their nodes.
+inline
+void refit(OcclusionCulling& oc, const SceneGraph& sg) {
+    oc.occluder_positions.resize(size(oc.occluder_object_positions));
+    for(auto& o : oc.occluders) {
+        auto& world = sg.world_transforms[o.node];
+        for(auto i = o.first_position; i < o.first_position + o.position_count; ++i) {
+            oc.occluder_positions[i] = world * glm::vec4(oc.occluder_object_positions[i], 1.f);
+        }
+    }
+}
+
+// Picks triangle meshes of at most 'max_mesh_triangles' by decreasing world
+// bounds area until 'max_triangles' is reached.
+inline
+OcclusionCulling occlusion_culling(
+    const scene_cache::Reader& cache,
+    const SceneGraph& sg,
+    std::span<const Mesh> meshes,
+    std::size_t max_triangles = 16384,
+    std::size_t max_mesh_triangles = 2048)
+{
+    auto oc = OcclusionCulling();
+    auto records = cache.meshes();
+    struct Candidate {
+        std::uint32_t node;
+        MeshId mesh;
+        float area;
+    };
+    auto candidates = std::vector<Candidate>();
+    for(std::size_t ni = 0; ni < node_count(sg); ++ni) {
+        for(auto mi : ::meshes(sg, ni)) {
+            auto& m = meshes[mi];
+            auto& record = records[mi];
+            if(m.draw_mode != GL_TRIANGLES or record.positions == 0
+                or record.indices == 0 or is_empty(m.bounds)
+                or std::size_t(m.draw_count) / 3 > max_mesh_triangles)
+            {
+                continue;
+            }
+            auto e = extent(transformed(m.bounds, sg.world_transforms[ni]));
+            candidates.push_back({std::uint32_t(ni), mi,
+                e.x * e.y + e.y * e.z + e.z * e.x});
+        }
+    }
+    std::sort(begin(candidates), end(candidates),
+        [](const Candidate& a, const Candidate& b) { return a.area > b.area; });
+    auto triangle_count = std::size_t(0);
+    for(auto& c : candidates) {
+        auto& record = records[c.mesh];
+        if(triangle_count + record.index_count / 3 > max_triangles) {
+            continue;
+        }
+        triangle_count += record.index_count / 3;
+        auto base = std::uint32_t(size(oc.occluder_object_positions));
+        oc.occluders.push_back({c.node, base, record.vertex_count});
+        for(auto& p : cache.array<glm::vec3>(record.positions, record.vertex_count)) {
+            oc.occluder_object_positions.push_back(p);
+        }
+        auto indices = cache.array<std::byte>(record.indices,
+            std::size_t(record.index_count) * record.index_size);
+        for(std::size_t i = 0; i < record.index_count; ++i) {
+            auto index = std::uint32_t(0);
+            std::memcpy(&index, indices.data() + i * record.index_size,
+                record.index_size);
+            oc.occluder_indices.push_back(base + index);
+        }
+    }
+    refit(oc, sg);
+    return oc;
+}
+
+// Clears 'fc.visible' for the visible nodes hidden behind the occluders.
+inline
+void cull(
+    OcclusionCulling& oc,
+    FrustumCulling& fc,
+    const glm::mat4& world_to_clip)
+{
+    oc.occluded_count = 0;
+    if(not oc.is_enabled) {
+        oc.rasterized_count = 0;
+        oc.rasterize_seconds = 0.f;
+        oc.test_seconds = 0.f;
+        return;
+    }
+    auto clock = Clock();
+    { // Occluders.
+        oc.occluder_clip_positions.resize(size(oc.occluder_positions));
+        for(std::size_t i = 0; i < size(oc.occluder_positions); ++i) {
+            oc.occluder_clip_positions[i] = world_to_clip * oc.occluder_positions[i];
+        }
+        clear(oc.depth);
+        oc.rasterized_count = rasterize(oc.depth,
+            oc.occluder_clip_positions, oc.occluder_indices);
+        build_pyramid(oc.depth);
+    }
+    oc.rasterize_seconds = clock.restart().count();
+    { // Tests.
+        for(std::size_t i = 0; i < size(fc.nodes); ++i) {
+            auto ni = fc.nodes[i];
+            if(fc.visible[ni] and is_occluded(oc.depth, fc.bounds[i], world_to_clip)) {
+                fc.visible[ni] = 0;
+                oc.occluded_count += 1;
+            }
+        }
+    }
+    oc.test_seconds = clock.restart().count();
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "object_ring.hpp"
+#include "../material/material_table.hpp"
+#include "../mesh/mesh.hpp"
+#include "../mesh/vertex_format.hpp"
+#include "../scene_graph/scene_graph.hpp"
+
+#include "common/opengl/command_list.hpp"
+#include "common/thread/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+inline constexpr std::size_t recorded_partition_node_count = 256;
+
+// Consecutive nodes recorded by one task.
+struct RecordedPartition {
+    std::size_t first_node = 0;
+    std::size_t node_count = 0;
+
+    CommandList commands;
+    // Indexed by the recorded base instances.
+    std::vector<ObjectData> objects;
+
+    // Inputs of the last recording, it is reused while they are unchanged.
+    std::vector<std::uint8_t> visible;
+    VertexFormat format = VertexFormat::separate;
+    glsl::SolidFeatures features = 0;
+    bool is_recorded = false;
+};
+
+// Scene partitions recorded into command lists on a thread pool and replayed
+// in order on the context thread.
+struct RecordedDraws {
+    std::vector<RecordedPartition> partitions;
+    // Partitions recorded by the last 'record', the others were reused.
+    std::size_t recorded_count = 0;
+};
+
+inline
+RecordedDraws recorded_draws(const SceneGraph& sg) {
+    auto rd = RecordedDraws();
+    for(std::size_t first = 0; first < node_count(sg);
+        first += recorded_partition_node_count)
+    {
+        auto& p = rd.partitions.emplace_back();
+        p.first_node = first;
+        p.node_count = std::min(recorded_partition_node_count,
+            node_count(sg) - first);
+    }
+    return rd;
+}
+
+// World transforms changed, every partition must be recorded again.
+inline
+void invalidate(RecordedDraws& rd) {
+    for(auto& p : rd.partitions) {
+        p.is_recorded = false;
+    }
+}
+
+// Records the partitions whose visible nodes, vertex format or frame
+// features changed. 'mesh_programs' holds the variant of each mesh for
+// 'features', 0 while not linked, in which case the partition is recorded
+// again next time. 'vertex_array' must match 'format'.
+inline
+void record(
+    RecordedDraws& rd,
+    ThreadPool& pool,
+    const SceneGraph& sg,
+    std::span<const Mesh> meshes,
+    const std::vector<std::uint8_t>& visible,
+    VertexFormat format,
+    glsl::SolidFeatures features,
+    std::span<const GLuint> mesh_programs,
+    GLuint vertex_array)
+{
+    auto recorded_count = std::atomic<std::size_t>(0);
+    pool.parallel_for(size(rd.partitions), [&](std::size_t pi) {
+        auto& p = rd.partitions[pi];
+        auto first = begin(visible) + std::ptrdiff_t(p.first_node);
+        auto last = first + std::ptrdiff_t(p.node_count);
+        if(p.is_recorded and p.format == format and p.features == features
+            and std::equal(first, last, begin(p.visible)))
+        {
+            return;
+        }
+        p.visible.assign(first, last);
+        p.format = format;
+        p.features = features;
+        p.is_recorded = true;
+        recorded_count += 1;
+
+        clear(p.commands);
+        p.objects.clear();
+        bind_vertex_array(p.commands, vertex_array);
+        auto program = GLuint(0);
+        for(auto ni = p.first_node; ni < p.first_node + p.node_count; ++ni) {
+            if(sg.mesh_counts[ni] == 0 or not visible[ni]) {
+                continue;
+            }
+            for(auto mi : ::meshes(sg, ni)) {
+                auto& m = meshes[mi];
+                if(m.draw_count == 0) {
+                    continue;
+                }
+                if(mesh_programs[mi] == 0) {
+                    p.is_recorded = false;
+                    continue;
+                }
+                if(mesh_programs[mi] != program) {
+                    program = mesh_programs[mi];
+                    use_program(p.commands, program);
+                }
+                draw_elements(p.commands, m.draw_mode, m.draw_count,
+                    m.draw_type, m.index_offset, 1, m.base_vertex,
+                    GLuint(size(p.objects)));
+                p.objects.push_back(object_data(sg.world_transforms[ni],
+                    (format == VertexFormat::quantized)
+                    ? m.quantization
+                    : PositionQuantization(),
+                    material_index(m.material)));
+            }
+        }
+    });
+    rd.recorded_count = recorded_count;
+}
+
+// Writes the objects of every partition to 'ring' and replays the lists.
+// Returns the number of draw calls.
+inline
+std::size_t execute(const RecordedDraws& rd, ObjectRing& ring) {
+    auto draw_calls = std::size_t(0);
+    for(auto& p : rd.partitions) {
+        if(p.objects.empty()) {
+            continue;
+        }
+        auto first_object = write(ring, p.objects);
+        draw_calls += execute(p.commands, first_object);
+    }
+    return draw_calls;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "../mesh/vertex_array.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/glsl/solid_renderer/solid_variants.hpp"
+#include "common/sort/radix_sort.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Most significant first: pass, program, vertex array, material, then
+// view depth so opaque draws of the same state go front to back.
+enum class RenderPass : std::uint64_t {
+    opaque = 0,
+    overlay = 1,
+};
+
+inline constexpr int render_key_pass_bits = 2;
+// Holds every variant index, checked in 'solid_variants.hpp'.
+inline constexpr int render_key_program_bits = glsl::solid_variant_index_bits;
+inline constexpr int render_key_vertex_array_bits = 8;
+inline constexpr int render_key_material_bits = 16;
+inline constexpr int render_key_depth_bits = 32;
+
+static_assert(render_key_pass_bits + render_key_program_bits
+    + render_key_vertex_array_bits + render_key_material_bits
+    + render_key_depth_bits == 64);
+
+inline constexpr int render_key_material_shift = render_key_depth_bits;
+inline constexpr int render_key_vertex_array_shift
+    = render_key_material_shift + render_key_material_bits;
+inline constexpr int render_key_program_shift
+    = render_key_vertex_array_shift + render_key_vertex_array_bits;
+inline constexpr int render_key_pass_shift
+    = render_key_program_shift + render_key_program_bits;
+
+// 'program' and 'vertex_array' are small indices chosen by the caller.
+// 'depth' is the view distance, non negative floats order like their bits.
+// Throws if an index does not fit its field, it would otherwise sort with
+// another program, vertex array or material.
+inline
+std::uint64_t render_key(
+    RenderPass pass,
+    std::uint64_t program,
+    std::uint64_t vertex_array,
+    std::uint64_t material,
+    float depth)
+{
+    auto field = [](std::uint64_t value, int bits, int shift, const char* name) {
+        if(value >> bits != 0) {
+            throw std::runtime_error(std::string("Render key ") + name
+                + " index " + std::to_string(value) + " out of range.");
+        }
+        return value << shift;
+    };
+    return field(std::uint64_t(pass), render_key_pass_bits, render_key_pass_shift, "pass")
+        | field(program, render_key_program_bits, render_key_program_shift, "program")
+        | field(vertex_array, render_key_vertex_array_bits, render_key_vertex_array_shift, "vertex array")
+        | field(material, render_key_material_bits, render_key_material_shift, "material")
+        | std::uint64_t(std::bit_cast<std::uint32_t>(std::max(depth, 0.f)));
+}
+
+inline
+std::uint64_t render_key_material(std::uint64_t key) {
+    return (key >> render_key_material_shift)
+        & ((std::uint64_t(1) << render_key_material_bits) - 1);
+}
+
+struct RenderItem {
+    GLuint program;
+    // Bound to the shared vertex array of 'format', see 'VertexArrayCache'.
+    VertexFormat format;
+    const VertexBuffers* buffers;
+    GLenum mode;
+    GLsizei count;
+    GLenum type;
+    std::size_t index_offset;
+    GLint base_vertex;
+    // Object index, see 'ObjectRing'.
+    GLuint base_instance;
+};
+
+// State changes when submitting in some order.
+struct RenderQueueBinds {
+    std::size_t programs = 0;
+    std::size_t vertex_arrays = 0;
+    // Runs of draws with the same material. Not binds, materials are
+    // selected by the object data, but what the key groups for locality.
+    std::size_t material_runs = 0;
+};
+
+// Draws pushed in any order, sorted by key and submitted with the
+// redundant program and vertex array binds skipped. Materials are selected
+// by the object data, see 'MaterialTable'.
+struct RenderQueue {
+    std::vector<std::uint64_t> keys;
+    std::vector<RenderItem> items;
+    // Indices of 'items', by key after 'sort'.
+    std::vector<std::uint32_t> order;
+
+    std::vector<std::uint64_t> key_scratch;
+    std::vector<std::uint32_t> order_scratch;
+
+    // Of the last submission, in push order and in key order.
+    RenderQueueBinds unsorted_binds;
+    RenderQueueBinds sorted_binds;
+};
+
+inline
+void clear(RenderQueue& q) {
+    q.keys.clear();
+    q.items.clear();
+    q.order.clear();
+}
+
+inline
+void push(RenderQueue& q, std::uint64_t key, const RenderItem& item) {
+    q.order.push_back(std::uint32_t(size(q.items)));
+    q.keys.push_back(key);
+    q.items.push_back(item);
+}
+
+// 'keys[i]' is the key of 'items[order[i]]'.
+inline
+RenderQueueBinds binds(
+    const RenderQueue& q,
+    const std::vector<std::uint64_t>& keys,
+    const std::vector<std::uint32_t>& order)
+{
+    auto b = RenderQueueBinds();
+    for(std::size_t i = 0; i < size(order); ++i) {
+        auto& item = q.items[order[i]];
+        auto& previous = q.items[order[(i > 0) ? i - 1 : i]];
+        if(i == 0 or item.program != previous.program) {
+            b.programs += 1;
+        }
+        if(i == 0 or item.format != previous.format
+            or item.buffers != previous.buffers)
+        {
+            b.vertex_arrays += 1;
+        }
+        if(i == 0 or render_key_material(keys[i])
+            != render_key_material(keys[i - 1]))
+        {
+            b.material_runs += 1;
+        }
+    }
+    return b;
+}
+
+inline
+void sort(RenderQueue& q) {
+    q.unsorted_binds = binds(q, q.keys, q.order);
+    radix_sort(q.keys, q.order, q.key_scratch, q.order_scratch);
+    q.sorted_binds = binds(q, q.keys, q.order);
+}
+
+// Returns the number of draw calls.
+inline
+std::size_t submit(const RenderQueue& q, VertexArrayCache& vertex_arrays) {
+    auto program = GLuint(0);
+    const RenderItem* previous = nullptr;
+    for(std::size_t i = 0; i < size(q.order); ++i) {
+        auto& item = q.items[q.order[i]];
+        if(i == 0 or item.program != program) {
+            program = item.program;
+            glUseProgram(program);
+        }
+        if(i == 0 or item.format != previous->format
+            or item.buffers != previous->buffers)
+        {
+            glBindVertexArray(bind_buffers(vertex_arrays,
+                item.format, *item.buffers));
+        }
+        previous = &item;
+        glDrawElementsInstancedBaseVertexBaseInstance(item.mode,
+            item.count,
+            item.type,
+            reinterpret_cast<const void*>(item.index_offset),
+            1,
+            item.base_vertex,
+            item.base_instance);
+    }
+    return size(q.order);
+}
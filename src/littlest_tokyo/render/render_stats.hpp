@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdlib>
+
+enum class RenderMode {
+    // One draw call per mesh instance, its object selected by base instance.
+    direct,
+    // One 'glMultiDrawElementsIndirect' per primitive mode, index type and
+    // mesh features.
+    multi_draw_indirect,
+    // Culled and compacted by a compute shader, one
+    // 'glMultiDrawElementsIndirectCount' per batch of 'multi_draw_indirect'.
+    gpu_driven,
+    // One 'glDrawElementsInstancedBaseVertexBaseInstance' per visible mesh.
+    instanced,
+    // Command lists recorded per scene partition on the thread pool, reused
+    // while their visible nodes are unchanged.
+    recorded,
+};
+
+inline constexpr std::size_t render_mode_count = 5;
+
+inline constexpr const char* render_mode_names[render_mode_count] = {
+    "Direct",
+    "Multi draw indirect",
+    "GPU driven",
+    "Instanced",
+    "Recorded",
+};
+
+struct RenderStats {
+    std::size_t draw_calls = 0;
+    std::size_t mesh_instances = 0;
+    // CPU time to record and submit the scene, smoothed over frames.
+    float submit_seconds = 0.f;
+};
+
+inline
+void record_submit(RenderStats& s, float seconds) {
+    s.submit_seconds = (s.submit_seconds == 0.f)
+        ? seconds
+        : s.submit_seconds + 0.05f * (seconds - s.submit_seconds);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+
+// Offscreen color and depth, so depth can be sampled after the frame.
+struct RenderTarget {
+    gl::FramebufferObject framebuffer;
+    gl::TextureObject color;
+    gl::TextureObject depth;
+    int width = 0;
+    int height = 0;
+};
+
+// Reallocates the attachments when the size changed.
+inline
+void resize(RenderTarget& rt, int width, int height) {
+    if(width == rt.width and height == rt.height) {
+        return;
+    }
+    rt.width = width;
+    rt.height = height;
+    rt.color = gl::Texture(GL_TEXTURE_2D);
+    glTextureStorage2D(rt.color, 1, GL_RGBA8, width, height);
+    rt.depth = gl::Texture(GL_TEXTURE_2D);
+    glTextureStorage2D(rt.depth, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTextureParameteri(rt.depth, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(rt.depth, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glNamedFramebufferTexture(rt.framebuffer, GL_COLOR_ATTACHMENT0, rt.color, 0);
+    glNamedFramebufferTexture(rt.framebuffer, GL_DEPTH_ATTACHMENT, rt.depth, 0);
+}
+
+// Copies the color to the default framebuffer and binds it.
+inline
+void present(const RenderTarget& rt) {
+    glBlitNamedFramebuffer(rt.framebuffer, 0,
+        0, 0, rt.width, rt.height,
+        0, 0, rt.width, rt.height,
+        GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
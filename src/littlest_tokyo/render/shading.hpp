@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../mesh/vertex_format.hpp"
+
+#include "common/glsl/solid_renderer/solid_variants.hpp"
+
+#include <cstdlib>
+
+// What the solid renderer outputs, each mesh then draws with the minimal
+// variant of its features and these.
+enum class Shading {
+    // Sampled from the texture arrays, grey for meshes whose material has
+    // no texture, see 'Mesh::features'.
+    base_color,
+    // World normals, from derivatives for meshes without normals.
+    normals,
+    flat_normals,
+    texcoords,
+};
+
+inline constexpr std::size_t shading_count = 4;
+
+inline constexpr const char* shading_names[shading_count] = {
+    "Base color",
+    "Normals",
+    "Flat normals",
+    "Texcoords",
+};
+
+// Features shared by every mesh of a frame.
+inline
+glsl::SolidFeatures frame_features(Shading s, VertexFormat format) {
+    using enum glsl::SolidFeature;
+    auto fs = (format != VertexFormat::separate)
+        ? bit(compact_vertex)
+        : glsl::SolidFeatures(0);
+    switch(s) {
+    case Shading::base_color: return fs;
+    case Shading::normals: return fs | bit(normal_view);
+    case Shading::flat_normals: return fs | bit(normal_view) | bit(flat_shading);
+    default: return fs | bit(texcoords_view);
+    }
+}
+
+// Of the quad and the sphere gizmos, separate vertices with normals.
+inline
+glsl::SolidFeatures gizmo_features(Shading s) {
+    return frame_features(s, VertexFormat::separate)
+        | bit(glsl::SolidFeature::has_normals);
+}
@@ -0,0 +1,565 @@
+#pragma once
+
+#include "../assimp/conversion.hpp"
+#include "../mesh/vertex_format.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/filesystem/mapped_file.hpp"
+#include "common/filesystem/write_file.hpp"
+#include "common/geometry/aabb.hpp"
+#include "common/hash/hash.hpp"
+#include "common/mesh/all.hpp"
+#include "common/thread/thread_pool.hpp"
+#include "common/time/clock.hpp"
+
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// Binary snapshot of an imported scene.
+// Every table and vertex stream lives at an aligned offset of the file,
+// so that a memory mapping can be handed to the driver as is.
+
+namespace scene_cache {
+
+// Bump whenever the layout of the file or the import changes.
+inline constexpr std::uint32_t version = 4;
+
+inline constexpr auto magic = std::array<char, 8>{
+    'L', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+
+inline constexpr unsigned import_flags
+= aiProcess_Triangulate
+| aiProcess_FlipUVs;
+
+// Vertex cache, overdraw and vertex fetch optimization of triangle meshes.
+inline constexpr bool optimize_meshes = true;
+
+// Some drivers emulate 8 bit indices and report it as a performance issue.
+inline constexpr bool byte_indices = false;
+
+inline constexpr std::uint32_t no_index = ~std::uint32_t(0);
+
+inline constexpr std::uint64_t alignment = 16;
+
+struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t mesh_count;
+    std::uint64_t source_hash;
+    std::uint64_t file_size;
+
+    // Seconds spent in Assimp when the cache was created.
+    float import_seconds;
+
+    std::uint32_t node_count;
+    std::uint32_t node_mesh_count;
+    std::uint32_t material_count;
+    std::uint32_t texture_count;
+    std::uint32_t string_size;
+
+    std::uint64_t meshes;
+    std::uint64_t nodes;
+    std::uint64_t node_meshes;
+    std::uint64_t materials;
+    std::uint64_t textures;
+    std::uint64_t strings;
+};
+
+// Offsets of absent attributes are zero.
+struct MeshRecord {
+    std::uint32_t draw_mode;
+    std::uint32_t material;
+    std::uint32_t index_count;
+    std::uint32_t vertex_count;
+
+    // In bytes: 1, 2 or 4.
+    std::uint32_t index_size;
+
+    std::uint64_t indices;
+    std::uint64_t normals;
+    std::uint64_t positions;
+    std::uint64_t texcoords0;
+
+    // Compact formats, present for any mesh with vertices.
+    std::uint64_t interleaved;
+    std::uint64_t quantized;
+
+    // Object space, empty without positions.
+    Aabb bounds;
+
+    // Before and after optimization, zero for meshes left untouched.
+    mesh::VertexCacheStats vertex_cache_before;
+    mesh::VertexCacheStats vertex_cache_after;
+};
+
+// Nodes are stored in preorder, parents always come before their children.
+struct NodeRecord {
+    float transform[16];
+
+    std::uint32_t parent;
+    std::uint32_t first_mesh;
+    std::uint32_t mesh_count;
+};
+
+struct MaterialRecord {
+    std::uint32_t base_color_texture;
+};
+
+// Paths are relative to the scene file.
+struct TextureRecord {
+    std::uint32_t path_offset;
+    std::uint32_t path_size;
+};
+
+// Hash of everything the import depends on: the scene file, its binary
+// buffers, the import flags and the cache version.
+inline
+std::uint64_t source_hash(const std::filesystem::path& scene_path) {
+    auto h = hash::combine(hash::seed, version);
+    h = hash::combine(h, import_flags);
+    h = hash::combine(h, optimize_meshes);
+    h = hash::combine(h, byte_indices);
+    auto files = std::vector<std::filesystem::path>{scene_path};
+    for(auto& entry : std::filesystem::directory_iterator(scene_path.parent_path())) {
+        if(entry.is_regular_file() and entry.path().extension() == ".bin") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(begin(files) + 1, end(files));
+    for(auto& file : files) {
+        h = hash::string(file.filename().string(), h);
+        h = hash::bytes(filesystem::MappedFile(file).bytes(), h);
+    }
+    return h;
+}
+
+struct Timings {
+    float layout_seconds = 0.f;
+    float prepare_seconds = 0.f;
+};
+
+// Mesh streams are laid out first, then optimized and filled in parallel by 'pool'.
+inline
+std::vector<std::byte> serialize(
+    const aiScene& scene,
+    std::uint64_t source_hash,
+    float import_seconds,
+    ThreadPool& pool,
+    Timings& timings)
+{
+    auto bytes = std::vector<std::byte>(sizeof(Header));
+    auto align = [&]() {
+        auto offset = (size(bytes) + alignment - 1) / alignment * alignment;
+        bytes.resize(offset);
+        return std::uint64_t(offset);
+    };
+    auto allocate = [&](std::size_t size) {
+        auto offset = align();
+        bytes.resize(offset + size);
+        return offset;
+    };
+    auto append = [&](const void* data, std::size_t size) {
+        auto offset = allocate(size);
+        if(size > 0) {
+            std::memcpy(bytes.data() + offset, data, size);
+        }
+        return offset;
+    };
+
+    auto header = Header();
+    header.magic = magic;
+    header.version = version;
+    header.source_hash = source_hash;
+    header.import_seconds = import_seconds;
+
+    { // Textures and materials.
+        auto strings = std::string();
+        auto textures = std::vector<TextureRecord>();
+        auto texture_ids = std::map<std::string, std::uint32_t>();
+        auto materials = std::vector<MaterialRecord>();
+        for(unsigned mi = 0; mi < scene.mNumMaterials; ++mi) {
+            auto& ai_material = *scene.mMaterials[mi];
+            auto& record = materials.emplace_back();
+            record.base_color_texture = no_index;
+            for(auto type : {aiTextureType_BASE_COLOR, aiTextureType_DIFFUSE}) {
+                if(ai_material.GetTextureCount(type) > 0) {
+                    auto path = aiString();
+                    ai_material.GetTexture(type, 0, &path);
+                    auto [it, inserted] = texture_ids.emplace(
+                        path.C_Str(), std::uint32_t(size(textures)));
+                    if(inserted) {
+                        textures.push_back(TextureRecord{
+                            .path_offset = std::uint32_t(size(strings)),
+                            .path_size = std::uint32_t(path.length)});
+                        strings += it->first;
+                    }
+                    record.base_color_texture = it->second;
+                    break;
+                }
+            }
+        }
+        header.material_count = std::uint32_t(size(materials));
+        header.materials = append(materials.data(),
+            size(materials) * sizeof(MaterialRecord));
+        header.texture_count = std::uint32_t(size(textures));
+        header.textures = append(textures.data(),
+            size(textures) * sizeof(TextureRecord));
+        header.string_size = std::uint32_t(size(strings));
+        header.strings = append(strings.data(), size(strings));
+    }
+    { // Nodes.
+        auto nodes = std::vector<NodeRecord>();
+        auto node_meshes = std::vector<std::uint32_t>();
+        auto traversal = [&](const aiNode& ai_node, std::uint32_t parent, auto self) -> void {
+            auto index = std::uint32_t(size(nodes));
+            auto& record = nodes.emplace_back();
+            auto transform = to_glm(ai_node.mTransformation);
+            std::memcpy(record.transform, &transform[0][0], sizeof(record.transform));
+            record.parent = parent;
+            record.first_mesh = std::uint32_t(size(node_meshes));
+            record.mesh_count = ai_node.mNumMeshes;
+            node_meshes.insert(end(node_meshes),
+                ai_node.mMeshes, ai_node.mMeshes + ai_node.mNumMeshes);
+            for(unsigned ci = 0; ci < ai_node.mNumChildren; ++ci) {
+                self(*ai_node.mChildren[ci], index, self);
+            }
+        };
+        traversal(*scene.mRootNode, no_index, traversal);
+        header.node_count = std::uint32_t(size(nodes));
+        header.nodes = append(nodes.data(),
+            size(nodes) * sizeof(NodeRecord));
+        header.node_mesh_count = std::uint32_t(size(node_meshes));
+        header.node_meshes = append(node_meshes.data(),
+            size(node_meshes) * sizeof(std::uint32_t));
+    }
+    { // Meshes.
+        auto clock = Clock();
+        auto records = std::vector<MeshRecord>(scene.mNumMeshes);
+        header.mesh_count = scene.mNumMeshes;
+        header.meshes = allocate(size(records) * sizeof(MeshRecord));
+        { // Layout.
+            pool.parallel_for(size(records), [&](std::size_t mi) {
+                auto& ai_mesh = *scene.mMeshes[mi];
+                auto& record = records[mi];
+                record.draw_mode = GL_TRIANGLES;
+                record.material = ai_mesh.mMaterialIndex;
+                record.vertex_count = ai_mesh.mNumVertices;
+                record.index_size = std::uint32_t(
+                    mesh::index_size(ai_mesh.mNumVertices, byte_indices));
+                if(not ai_mesh.HasFaces()) {
+                    return;
+                }
+                if(ai_mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+                    record.index_count = 3 * ai_mesh.mNumFaces;
+                } else {
+                    for(unsigned fi = 0; fi < ai_mesh.mNumFaces; ++fi) {
+                        record.index_count += ai_mesh.mFaces[fi].mNumIndices;
+                    }
+                }
+            });
+            // Every stream gets its own aligned range of the file.
+            auto end_offset = std::uint64_t(size(bytes));
+            auto reserve = [&](std::uint64_t size) {
+                auto offset = (end_offset + alignment - 1) / alignment * alignment;
+                end_offset = offset + size;
+                return offset;
+            };
+            for(unsigned mi = 0; mi < scene.mNumMeshes; ++mi) {
+                auto& ai_mesh = *scene.mMeshes[mi];
+                auto& record = records[mi];
+                auto vertex_size = ai_mesh.mNumVertices * sizeof(aiVector3D);
+                if(record.index_count > 0) {
+                    record.indices = reserve(record.index_count * record.index_size);
+                }
+                if(ai_mesh.HasNormals()) {
+                    record.normals = reserve(vertex_size);
+                }
+                if(ai_mesh.HasPositions()) {
+                    record.positions = reserve(vertex_size);
+                }
+                if(ai_mesh.HasTextureCoords(0)) {
+                    record.texcoords0 = reserve(vertex_size);
+                }
+                if(ai_mesh.mNumVertices > 0) {
+                    record.interleaved = reserve(
+                        ai_mesh.mNumVertices * sizeof(InterleavedVertex));
+                    record.quantized = reserve(
+                        ai_mesh.mNumVertices * sizeof(QuantizedVertex));
+                }
+            }
+            bytes.resize(end_offset);
+            timings.layout_seconds = clock.restart().count();
+        }
+        { // Preparation.
+            // Meshes only write to their own ranges, no synchronization needed.
+            pool.parallel_for(size(records), [&](std::size_t mi) {
+                auto& ai_mesh = *scene.mMeshes[mi];
+                auto& record = records[mi];
+                auto indices = std::vector<std::uint32_t>(record.index_count);
+                if(record.index_count > 0) {
+                    auto out = indices.data();
+                    if(ai_mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+                        // Triangle only, fixed size copies.
+                        for(unsigned fi = 0; fi < ai_mesh.mNumFaces; ++fi) {
+                            std::memcpy(out, ai_mesh.mFaces[fi].mIndices,
+                                3 * sizeof(std::uint32_t));
+                            out += 3;
+                        }
+                    } else {
+                        for(unsigned fi = 0; fi < ai_mesh.mNumFaces; ++fi) {
+                            auto& face = ai_mesh.mFaces[fi];
+                            std::memcpy(out, face.mIndices,
+                                face.mNumIndices * sizeof(std::uint32_t));
+                            out += face.mNumIndices;
+                        }
+                    }
+                }
+                auto remap = std::vector<std::uint32_t>();
+                if(optimize_meshes
+                    and ai_mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE
+                    and record.index_count > 0)
+                {
+                    record.vertex_cache_before = mesh::analyze_vertex_cache(
+                        indices, ai_mesh.mNumVertices);
+                    mesh::optimize_vertex_cache(indices, ai_mesh.mNumVertices);
+                    if(ai_mesh.HasPositions()) {
+                        mesh::optimize_overdraw(indices, std::span<const float>(
+                            &ai_mesh.mVertices[0].x, 3 * std::size_t(ai_mesh.mNumVertices)));
+                    }
+                    remap = mesh::optimize_vertex_fetch(indices, ai_mesh.mNumVertices);
+                    record.vertex_cache_after = mesh::analyze_vertex_cache(
+                        indices, ai_mesh.mNumVertices);
+                }
+                if(record.indices != 0) {
+                    mesh::narrow_indices(bytes.data() + record.indices,
+                        indices, record.index_size);
+                }
+                auto copy_vertices = [&](std::uint64_t offset, const aiVector3D* vertices) {
+                    if(remap.empty()) {
+                        std::memcpy(bytes.data() + offset, vertices,
+                            ai_mesh.mNumVertices * sizeof(aiVector3D));
+                    } else {
+                        mesh::remap_vertices(bytes.data() + offset, vertices,
+                            sizeof(aiVector3D), remap);
+                    }
+                };
+                if(record.normals != 0) {
+                    copy_vertices(record.normals, ai_mesh.mNormals);
+                }
+                if(record.positions != 0) {
+                    copy_vertices(record.positions, ai_mesh.mVertices);
+                    auto bounds = Aabb();
+                    for(unsigned vi = 0; vi < ai_mesh.mNumVertices; ++vi) {
+                        auto& v = ai_mesh.mVertices[vi];
+                        extend(bounds, glm::vec3(v.x, v.y, v.z));
+                    }
+                    record.bounds = bounds;
+                }
+                if(record.texcoords0 != 0) {
+                    copy_vertices(record.texcoords0, ai_mesh.mTextureCoords[0]);
+                }
+                if(record.interleaved != 0) {
+                    // Encoded from the reordered streams, absent ones read as zero.
+                    auto attribute = [&](std::uint64_t offset, unsigned vi) {
+                        auto a = glm::vec3(0.f);
+                        if(offset != 0) {
+                            std::memcpy(&a, bytes.data() + offset + vi * sizeof(a), sizeof(a));
+                        }
+                        return a;
+                    };
+                    auto q = position_quantization(record.bounds);
+                    for(unsigned vi = 0; vi < ai_mesh.mNumVertices; ++vi) {
+                        auto n = attribute(record.normals, vi);
+                        auto p = attribute(record.positions, vi);
+                        auto t = attribute(record.texcoords0, vi);
+                        auto iv = interleaved_vertex(n, p, t);
+                        std::memcpy(bytes.data() + record.interleaved + vi * sizeof(iv),
+                            &iv, sizeof(iv));
+                        auto qv = quantized_vertex(n, p, t, q);
+                        std::memcpy(bytes.data() + record.quantized + vi * sizeof(qv),
+                            &qv, sizeof(qv));
+                    }
+                }
+            });
+            timings.prepare_seconds = clock.restart().count();
+        }
+        std::memcpy(bytes.data() + header.meshes,
+            records.data(), size(records) * sizeof(MeshRecord));
+    }
+    header.file_size = align();
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    return bytes;
+}
+
+inline
+void write(
+    const std::filesystem::path& path,
+    std::span<const std::byte> bytes)
+{
+    filesystem::write_file(path, bytes);
+}
+
+class Reader {
+    std::variant<filesystem::MappedFile, std::vector<std::byte>> storage;
+    std::span<const std::byte> bytes;
+
+    bool contains(
+        std::uint64_t offset,
+        std::uint64_t count,
+        std::uint64_t element_size,
+        std::uint64_t element_alignment) const noexcept
+    {
+        return offset % element_alignment == 0
+        and offset <= size(bytes)
+        and count <= (size(bytes) - offset) / element_size;
+    }
+
+    template<typename T>
+    bool contains(std::uint64_t offset, std::uint64_t count) const noexcept {
+        return contains(offset, count, sizeof(T), alignof(T));
+    }
+
+    // Checks every offset once so that accessors can trust them.
+    bool is_valid(std::uint64_t expected_source_hash) const noexcept {
+        if(size(bytes) < sizeof(Header)) {
+            return false;
+        }
+        auto& h = header();
+        if(h.magic != magic
+            or h.version != version
+            or h.source_hash != expected_source_hash
+            or h.file_size != size(bytes))
+        {
+            return false;
+        }
+        if(not contains<MeshRecord>(h.meshes, h.mesh_count)
+            or not contains<NodeRecord>(h.nodes, h.node_count)
+            or not contains<std::uint32_t>(h.node_meshes, h.node_mesh_count)
+            or not contains<MaterialRecord>(h.materials, h.material_count)
+            or not contains<TextureRecord>(h.textures, h.texture_count)
+            or not contains<char>(h.strings, h.string_size))
+        {
+            return false;
+        }
+        for(auto& m : meshes()) {
+            if(m.material >= h.material_count
+                or (m.index_size != 1 and m.index_size != 2 and m.index_size != 4)
+                or (m.indices != 0 and not contains(m.indices, m.index_count, m.index_size, m.index_size))
+                or (m.normals != 0 and not contains<float>(m.normals, 3 * std::uint64_t(m.vertex_count)))
+                or (m.positions != 0 and not contains<float>(m.positions, 3 * std::uint64_t(m.vertex_count)))
+                or (m.texcoords0 != 0 and not contains<float>(m.texcoords0, 3 * std::uint64_t(m.vertex_count)))
+                or (m.interleaved != 0 and not contains<InterleavedVertex>(m.interleaved, m.vertex_count))
+                or (m.quantized != 0 and not contains<QuantizedVertex>(m.quantized, m.vertex_count)))
+            {
+                return false;
+            }
+        }
+        for(std::size_t ni = 0; ni < h.node_count; ++ni) {
+            auto& n = nodes()[ni];
+            auto is_root = (ni == 0);
+            if(is_root != (n.parent == no_index)
+                or (not is_root and n.parent >= ni)
+                or std::uint64_t(n.first_mesh) + n.mesh_count > h.node_mesh_count)
+            {
+                return false;
+            }
+        }
+        for(auto mi : node_meshes()) {
+            if(mi >= h.mesh_count) {
+                return false;
+            }
+        }
+        for(auto& m : materials()) {
+            if(m.base_color_texture != no_index and m.base_color_texture >= h.texture_count) {
+                return false;
+            }
+        }
+        for(auto& t : textures()) {
+            if(std::uint64_t(t.path_offset) + t.path_size > h.string_size) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename Storage>
+    static std::optional<Reader> make(Storage&& storage, std::uint64_t source_hash) {
+        auto r = std::optional<Reader>(std::in_place);
+        r->storage = std::forward<Storage>(storage);
+        r->bytes = std::visit([](auto& s) {
+            return std::span<const std::byte>(s.data(), s.size());
+        }, r->storage);
+        if(not r->is_valid(source_hash)) {
+            return std::nullopt;
+        }
+        return r;
+    }
+
+public:
+    // Empty if the file is missing, corrupted or stale.
+    static std::optional<Reader> open(
+        const std::filesystem::path& path,
+        std::uint64_t source_hash)
+    {
+        if(not std::filesystem::is_regular_file(path)) {
+            return std::nullopt;
+        }
+        return make(filesystem::MappedFile(path), source_hash);
+    }
+
+    static std::optional<Reader> from_bytes(
+        std::vector<std::byte> bytes,
+        std::uint64_t source_hash)
+    {
+        return make(std::move(bytes), source_hash);
+    }
+
+    const Header& header() const noexcept {
+        return *reinterpret_cast<const Header*>(bytes.data());
+    }
+
+    template<typename T>
+    std::span<const T> array(std::uint64_t offset, std::size_t count) const noexcept {
+        return {reinterpret_cast<const T*>(bytes.data() + offset), count};
+    }
+
+    std::span<const MeshRecord> meshes() const noexcept {
+        return array<MeshRecord>(header().meshes, header().mesh_count);
+    }
+
+    std::span<const NodeRecord> nodes() const noexcept {
+        return array<NodeRecord>(header().nodes, header().node_count);
+    }
+
+    std::span<const std::uint32_t> node_meshes() const noexcept {
+        return array<std::uint32_t>(header().node_meshes, header().node_mesh_count);
+    }
+
+    std::span<const MaterialRecord> materials() const noexcept {
+        return array<MaterialRecord>(header().materials, header().material_count);
+    }
+
+    std::span<const TextureRecord> textures() const noexcept {
+        return array<TextureRecord>(header().textures, header().texture_count);
+    }
+
+    std::string_view path(const TextureRecord& t) const noexcept {
+        return {reinterpret_cast<const char*>(bytes.data() + header().strings + t.path_offset),
+            t.path_size};
+    }
+};
+
+}
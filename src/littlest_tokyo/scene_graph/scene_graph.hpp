@@ -3,14 +3,91 @@
 #include "../mesh/id.hpp"
 
 #include "common/dependency/glm.hpp"
+#include "common/transform/kernels.hpp"
 
-#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
 #include <vector>
 
-struct SceneGraph {
-    glm::mat4 transform = glm::mat4(1.f);
+using transform::no_parent;
 
-    std::vector<std::unique_ptr<SceneGraph>> children;
+// Flat hierarchy, one entry per node in every array.
+// Nodes are in topological order: a parent always precedes its children,
+// so world transforms are computed by one forward pass.
+struct SceneGraph {
+    std::vector<std::uint32_t> parents;
+    std::vector<glm::mat4> local_transforms;
+    std::vector<glm::mat4> world_transforms;
+    // Local transform changed since the last 'update_world_transforms'.
+    std::vector<std::uint8_t> dirty;
+    bool is_dirty = false;
 
+    // Node 'i' draws 'meshes[first_meshes[i], first_meshes[i] + mesh_counts[i])'.
+    std::vector<std::uint32_t> first_meshes;
+    std::vector<std::uint32_t> mesh_counts;
     std::vector<MeshId> meshes;
 };
+
+inline
+std::size_t node_count(const SceneGraph& sg) {
+    return size(sg.parents);
+}
+
+// 'parent' must already be in 'sg', or 'no_parent'.
+inline
+std::uint32_t add_node(
+    SceneGraph& sg,
+    std::uint32_t parent,
+    const glm::mat4& local_transform,
+    std::span<const MeshId> meshes = {})
+{
+    auto ni = std::uint32_t(node_count(sg));
+    sg.parents.push_back(parent);
+    sg.local_transforms.push_back(local_transform);
+    sg.world_transforms.push_back(local_transform);
+    sg.dirty.push_back(1);
+    sg.is_dirty = true;
+    sg.first_meshes.push_back(std::uint32_t(size(sg.meshes)));
+    sg.mesh_counts.push_back(std::uint32_t(size(meshes)));
+    sg.meshes.insert(end(sg.meshes), begin(meshes), end(meshes));
+    return ni;
+}
+
+inline
+void set_local_transform(
+    SceneGraph& sg,
+    std::uint32_t node,
+    const glm::mat4& local_transform)
+{
+    sg.local_transforms[node] = local_transform;
+    sg.dirty[node] = 1;
+    sg.is_dirty = true;
+}
+
+inline
+std::span<const MeshId> meshes(const SceneGraph& sg, std::size_t node) {
+    return std::span(sg.meshes).subspan(sg.first_meshes[node], sg.mesh_counts[node]);
+}
+
+// Recomputes the world transforms of dirty nodes and their descendants only.
+// Returns the number of recomputed nodes.
+inline
+std::size_t update_world_transforms(SceneGraph& sg) {
+    if(not sg.is_dirty) {
+        return 0;
+    }
+    auto updated = std::size_t(0);
+    if(node_count(sg) > 0) {
+        updated = transform::kernels().propagate(
+            sg.parents.data(),
+            &sg.local_transforms[0][0][0],
+            sg.dirty.data(),
+            &sg.world_transforms[0][0][0],
+            node_count(sg));
+    }
+    std::fill(begin(sg.dirty), end(sg.dirty), std::uint8_t(0));
+    sg.is_dirty = false;
+    return updated;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "../scene_graph/scene_graph.hpp"
+
+#include "common/dependency/glm.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// Set in the UI.
+struct GizmoParameters {
+    glm::vec3 quad_position = glm::vec3(0.f);
+    float quad_scale = 1.f;
+
+    glm::vec3 sphere_position = glm::vec3(0.f);
+    glm::vec3 sphere_scale = glm::vec3(1.f);
+    bool draw_sphere = false;
+};
+
+// Interpolated between updates, unlike its matrices.
+struct CameraPose {
+    glm::vec3 position = glm::vec3(0.f);
+    glm::vec2 yaw_pitch = glm::vec2(0.f);
+};
+
+inline
+glm::mat4 world_to_view(const CameraPose& c) {
+    return glm::translate(
+        glm::rotate(
+            glm::rotate(
+                glm::mat4(1.f),
+                c.yaw_pitch.y,
+                glm::vec3(1.f, 0.f, 0.f)),
+            c.yaw_pitch.x,
+            glm::vec3(0.f, 1.f, 0.f)),
+        c.position);
+}
+
+// 't' in [0, 1] from 'a' to 'b'.
+inline
+CameraPose mix(const CameraPose& a, const CameraPose& b, float t) {
+    return {
+        .position = glm::mix(a.position, b.position, t),
+        .yaw_pitch = glm::mix(a.yaw_pitch, b.yaw_pitch, t),
+    };
+}
+
+// Polled on the main thread and forwarded to the simulation. Only absolute
+// state, so that the values skipped by a 'TripleBuffer' lose nothing.
+struct InputState {
+    // Camera movement keys held, unless the UI has the keyboard.
+    bool left = false;
+    bool right = false;
+    bool backward = false;
+    bool forward = false;
+    // Sum of the mouse moves while dragging, unless the UI has the mouse.
+    glm::vec2 drag = glm::vec2(0.f);
+
+    float camera_speed = 1.f;
+    GizmoParameters gizmos;
+};
+
+// What the render reads from the simulation, never changed once published.
+struct Snapshot {
+    // Before and after the update that published it, the render draws in
+    // between, see 'Scheduler::on_render'.
+    CameraPose previous_camera;
+    CameraPose camera;
+    glm::mat4 view_to_clip = glm::mat4(1.f);
+
+    // Copied only when 'transform_version' differs from the simulation.
+    std::vector<glm::mat4> world_transforms;
+    std::uint64_t transform_version = 0;
+    // Recomputed by the update that made 'transform_version'.
+    std::size_t transform_update_count = 0;
+
+    GizmoParameters gizmos;
+    // Of the update that published it.
+    std::uint64_t update_index = 0;
+};
+
+// State owned by the update thread.
+struct Simulation {
+    float dt = 1.f / 60.f;
+
+    // Copy of the scene, animated here.
+    SceneGraph scene;
+    // Bumped whenever world transforms change. Starts above the 0 of empty
+    // snapshots, as the render already has the initial transforms.
+    std::uint64_t transform_version = 1;
+    std::size_t transform_update_count = 0;
+
+    InputState input;
+    CameraPose previous_camera;
+    CameraPose camera;
+    glm::mat4 view_to_clip = glm::mat4(1.f);
+    glm::mat4 world_to_view = glm::mat4(1.f);
+
+    std::uint64_t update_index = 0;
+};
+
+inline
+Simulation simulation(const SceneGraph& sg, const glm::mat4& view_to_clip) {
+    auto s = Simulation();
+    s.scene = sg;
+    s.view_to_clip = view_to_clip;
+    return s;
+}
+
+inline
+void update(Simulation& s, const InputState& input) {
+    { // Camera.
+        auto forward = glm::vec3(inverse(s.world_to_view) * glm::vec4(0.f, 0.f, -1.f, 0.f));
+        auto right = glm::vec3(inverse(s.world_to_view) * glm::vec4(+1.f, 0.f, 0.f, 0.f));
+        auto step = input.camera_speed * s.dt;
+        s.previous_camera = s.camera;
+        auto& c = s.camera;
+        if(input.left) {
+            c.position += right * step;
+        }
+        if(input.right) {
+            c.position -= right * step;
+        }
+        if(input.backward) {
+            c.position += forward * step;
+        }
+        if(input.forward) {
+            c.position -= forward * step;
+        }
+        c.yaw_pitch += (input.drag - s.input.drag) / 100.f;
+        s.input = input;
+
+        s.world_to_view = ::world_to_view(c);
+    }
+    { // Scene.
+        auto count = update_world_transforms(s.scene);
+        if(count > 0) {
+            s.transform_update_count = count;
+            s.transform_version += 1;
+        }
+    }
+    s.update_index += 1;
+}
+
+// Writes every field of 'snapshot', which may hold an older state.
+inline
+void write(Snapshot& snapshot, const Simulation& s) {
+    snapshot.previous_camera = s.previous_camera;
+    snapshot.camera = s.camera;
+    snapshot.view_to_clip = s.view_to_clip;
+    if(snapshot.transform_version != s.transform_version) {
+        // Reuses the capacity of the slot.
+        snapshot.world_transforms.assign(
+            begin(s.scene.world_transforms), end(s.scene.world_transforms));
+        snapshot.transform_version = s.transform_version;
+        snapshot.transform_update_count = s.transform_update_count;
+    }
+    snapshot.gizmos = s.input.gizmos;
+    snapshot.update_index = s.update_index;
+}
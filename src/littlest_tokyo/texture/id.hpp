@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdlib>
+
+struct TextureId {
+    std::size_t value = 0;
+
+    TextureId() = default;
+
+    explicit
+    TextureId(std::size_t value)
+        : value(value)
+    {}
+
+    operator std::size_t() const noexcept {
+        return value;
+    }
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+// Place of a resident texture in 'TextureArrays'.
+struct TextureLayer {
+    std::uint32_t array = 0;
+    std::uint32_t layer = 0;
+};
+
+struct TextureResource
+{
+	std::filesystem::path file_path;
+
+	std::optional<TextureLayer> layer;
+};
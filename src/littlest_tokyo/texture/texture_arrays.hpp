@@ -0,0 +1,135 @@
+#pragma once
+
+#include "texture.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Size of 'base_color_arrays' in 'solid_renderer/shader.frag', bound to
+// texture units [0, max_texture_array_count).
+inline constexpr std::size_t max_texture_array_count = 8;
+
+// Layers of one format, size and level count.
+struct TextureArray {
+    GLenum internal_format = GL_RGBA8;
+    int width = 0;
+    int height = 0;
+    int level_count = 0;
+    gl::TextureObject texture;
+    int layer_count = 0;
+    int capacity = 0;
+};
+
+// Textures packed by compatibility into 'GL_TEXTURE_2D_ARRAY' layers, all
+// bound once per frame, so draws select a texture by index only.
+struct TextureArrays {
+    // The first holds a single grey texel, sampled until a texture is resident.
+    std::vector<TextureArray> arrays;
+    std::size_t grow_count = 0;
+};
+
+inline
+TextureArray texture_array(
+    GLenum internal_format,
+    int width,
+    int height,
+    int level_count,
+    int capacity)
+{
+    auto a = TextureArray();
+    a.internal_format = internal_format;
+    a.width = width;
+    a.height = height;
+    a.level_count = level_count;
+    a.capacity = capacity;
+    a.texture = gl::Texture(GL_TEXTURE_2D_ARRAY);
+    glTextureStorage3D(a.texture, level_count, internal_format,
+        width, height, capacity);
+    glTextureParameteri(a.texture, GL_TEXTURE_MIN_FILTER,
+        (level_count > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(a.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return a;
+}
+
+inline
+TextureArrays texture_arrays() {
+    auto ta = TextureArrays();
+    auto& placeholder = ta.arrays.emplace_back(
+        texture_array(GL_RGBA8, 1, 1, 1, 1));
+    auto grey = std::array<std::uint8_t, 4>{128, 128, 128, 255};
+    glTextureSubImage3D(placeholder.texture, 0, 0, 0, 0, 1, 1, 1,
+        GL_RGBA, GL_UNSIGNED_BYTE, grey.data());
+    placeholder.layer_count = 1;
+    return ta;
+}
+
+inline constexpr TextureLayer placeholder_layer = {0, 0};
+
+// Doubles the capacity, existing layers are copied on the GPU.
+inline
+void grow(TextureArray& a) {
+    auto grown = texture_array(a.internal_format,
+        a.width, a.height, a.level_count, 2 * a.capacity);
+    for(int level = 0; level < a.level_count; ++level) {
+        glCopyImageSubData(
+            a.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            grown.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            std::max(a.width >> level, 1), std::max(a.height >> level, 1),
+            a.layer_count);
+    }
+    grown.layer_count = a.layer_count;
+    a = std::move(grown);
+}
+
+// A layer for a texture of that format, size and level count.
+// Empty if it needs a new array and all texture units are taken.
+inline
+std::optional<TextureLayer> allocate(
+    TextureArrays& ta,
+    GLenum internal_format,
+    int width,
+    int height,
+    int level_count)
+{
+    auto it = std::find_if(begin(ta.arrays) + 1, end(ta.arrays), [&](auto& a) {
+        return a.internal_format == internal_format
+            and a.width == width
+            and a.height == height
+            and a.level_count == level_count;
+    });
+    if(it == end(ta.arrays)) {
+        if(size(ta.arrays) == max_texture_array_count) {
+            return std::nullopt;
+        }
+        ta.arrays.push_back(texture_array(internal_format,
+            width, height, level_count, 4));
+        it = end(ta.arrays) - 1;
+    }
+    if(it->layer_count == it->capacity) {
+        grow(*it);
+        ta.grow_count += 1;
+    }
+    return TextureLayer{
+        std::uint32_t(it - begin(ta.arrays)),
+        std::uint32_t(it->layer_count++),
+    };
+}
+
+// Units without an array get the placeholder, so every sampler is complete.
+inline
+void bind(const TextureArrays& ta) {
+    auto names = std::array<GLuint, max_texture_array_count>();
+    for(std::size_t i = 0; i < max_texture_array_count; ++i) {
+        names[i] = (i < size(ta.arrays))
+            ? GLuint(ta.arrays[i].texture)
+            : GLuint(ta.arrays[0].texture);
+    }
+    glBindTextures(0, GLsizei(size(names)), names.data());
+}
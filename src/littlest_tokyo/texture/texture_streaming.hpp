@@ -0,0 +1,291 @@
+#pragma once
+
+#include "id.hpp"
+#include "texture.hpp"
+#include "texture_arrays.hpp"
+
+#include "common/dependency/abstractgl_api_opengl.hpp"
+#include "common/dependency/opengl.hpp"
+#include "common/filesystem/mapped_file.hpp"
+#include "common/image/block_compression.hpp"
+#include "common/texture_cache/texture_cache.hpp"
+#include "common/thread/thread_pool.hpp"
+#include "common/time/clock.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+inline constexpr std::size_t texture_staging_region_count = 3;
+
+inline
+GLenum internal_format(image::BlockFormat f) {
+    switch(f) {
+    case image::BlockFormat::bc1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case image::BlockFormat::bc3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
+
+// Block compressed mip chain, loaded from the texture cache or cooked on a
+// worker.
+struct CookedTexture {
+    TextureId texture;
+    std::optional<texture_cache::Reader> cooked;
+    // Of the source file.
+    std::size_t file_size = 0;
+    bool is_cache_hit = false;
+};
+
+// Resident once every block row of every level is uploaded.
+struct TextureUpload {
+    TextureId texture;
+    TextureLayer layer;
+    std::optional<texture_cache::Reader> cooked;
+    std::size_t level = 0;
+    int block_row = 0;
+};
+
+// Textures are loaded from the texture cache, or decoded, mipmapped and
+// block compressed on a thread pool on a miss. Their blocks are then
+// uploaded through a persistently mapped pixel buffer with at most 'budget'
+// bytes per frame, so a frame never waits on a whole texture.
+struct TextureStreaming {
+    std::vector<std::future<CookedTexture>> decoding;
+    std::deque<TextureUpload> uploading;
+
+    // Pixel unpack buffer with a region of 'budget' bytes per frame in flight.
+    gl::BufferObj staging;
+    std::byte* mapped = nullptr;
+    std::size_t budget = 0;
+    std::size_t region = 0;
+    std::array<GLsync, texture_staging_region_count> fences = {};
+    // Translucent textures are cooked to BC7, or to BC3 without it.
+    bool has_bc7 = false;
+
+    // From the first request to the last resident texture.
+    Clock clock;
+    std::size_t requested_count = 0;
+    std::size_t resident_count = 0;
+    std::size_t failed_count = 0;
+    std::size_t cache_hit_count = 0;
+    std::size_t file_bytes = 0;
+    std::size_t uploaded_bytes = 0;
+    // Of every resident texture, and as uncompressed RGBA8 mip chains.
+    std::size_t resident_bytes = 0;
+    std::size_t rgba8_bytes = 0;
+    float seconds = 0.f;
+};
+
+inline
+TextureStreaming texture_streaming(std::size_t budget = std::size_t(4) << 20) {
+    auto ts = TextureStreaming();
+    ts.budget = budget;
+    ts.has_bc7 = GLEW_ARB_texture_compression_bptc;
+    auto flags = GLbitfield(
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+    auto bytes = GLsizeiptr(texture_staging_region_count * budget);
+    glNamedBufferStorage(ts.staging, bytes, nullptr, flags);
+    ts.mapped = static_cast<std::byte*>(
+        glMapNamedBufferRange(ts.staging, 0, bytes, flags));
+    if(ts.mapped == nullptr) {
+        throw std::runtime_error("Failed to map the texture staging buffer.");
+    }
+    return ts;
+}
+
+// Starts loading every texture of 'textures' on 'pool', cooked textures are
+// cached in 'cache_directory'.
+inline
+void request(
+    TextureStreaming& ts,
+    ThreadPool& pool,
+    const std::vector<TextureResource>& textures,
+    const std::filesystem::path& cache_directory)
+{
+    if(ts.requested_count == ts.resident_count + ts.failed_count) {
+        ts.clock.restart();
+    }
+    for(std::size_t ti = 0; ti < size(textures); ++ti) {
+        ts.decoding.push_back(pool.submit(
+            [texture = TextureId(ti), path = textures[ti].file_path, cache_directory,
+                has_bc7 = ts.has_bc7]()
+            {
+                auto file = filesystem::MappedFile(path);
+                auto hash = texture_cache::source_hash(file.bytes());
+                auto cache_path = texture_cache::path(cache_directory, hash);
+                auto t = CookedTexture{
+                    .texture = texture,
+                    .cooked = texture_cache::Reader::open(cache_path, hash),
+                    .file_size = file.size(),
+                };
+                if(t.cooked and not has_bc7
+                    and t.cooked->header().format == image::BlockFormat::bc7)
+                {
+                    // Cooked where BC7 could be sampled.
+                    t.cooked.reset();
+                }
+                t.is_cache_hit = t.cooked.has_value();
+                if(not t.is_cache_hit) {
+                    auto bytes = texture_cache::cook(file.bytes(),
+                        std::nullopt, nullptr, has_bc7);
+                    try {
+                        texture_cache::write(cache_path, bytes);
+                    } catch(const std::exception& e) {
+                        std::cerr << "Texture cache not written: " << e.what() << '\n';
+                    }
+                    t.cooked = texture_cache::Reader::from_bytes(std::move(bytes), hash);
+                }
+                return t;
+            }));
+        ts.requested_count += 1;
+    }
+}
+
+inline
+bool is_streaming(const TextureStreaming& ts) {
+    return not ts.decoding.empty() or not ts.uploading.empty();
+}
+
+// Megabytes of encoded files per second.
+inline
+float throughput(const TextureStreaming& ts) {
+    return (ts.seconds > 0.f)
+        ? float(ts.file_bytes) / 1e6f / ts.seconds
+        : 0.f;
+}
+
+// Collects decoded textures and uploads up to the budget into layers of
+// 'arrays', makes textures resident in 'textures' when complete.
+// Once per frame.
+inline
+void update(
+    TextureStreaming& ts,
+    TextureArrays& arrays,
+    std::vector<TextureResource>& textures)
+{
+    if(not is_streaming(ts)) {
+        return;
+    }
+    { // Decoded.
+        auto is_ready = [](std::future<CookedTexture>& f) {
+            return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        };
+        auto ready = std::stable_partition(begin(ts.decoding), end(ts.decoding),
+            [&](auto& f) { return not is_ready(f); });
+        for(auto it = ready; it != end(ts.decoding); ++it) {
+            try {
+                auto cooked = it->get();
+                auto& h = cooked.cooked->header();
+                auto layer = allocate(arrays, internal_format(h.format),
+                    int(h.width), int(h.height), int(h.level_count));
+                if(not layer) {
+                    throw std::runtime_error(
+                        "No texture unit left for a new texture array.");
+                }
+                auto& upload = ts.uploading.emplace_back();
+                upload.texture = cooked.texture;
+                upload.layer = *layer;
+                for(auto& l : cooked.cooked->levels()) {
+                    ts.rgba8_bytes += 4 * std::size_t(l.width) * l.height;
+                }
+                ts.resident_bytes += cooked.cooked->block_size();
+                upload.cooked = std::move(cooked.cooked);
+                ts.file_bytes += cooked.file_size;
+                ts.cache_hit_count += cooked.is_cache_hit;
+            } catch(const std::exception& e) {
+                std::cerr << "Texture not loaded: " << e.what() << '\n';
+                ts.failed_count += 1;
+            }
+        }
+        ts.decoding.erase(ready, end(ts.decoding));
+    }
+    if(not ts.uploading.empty()) { // Upload.
+        ts.region = (ts.region + 1) % texture_staging_region_count;
+        auto& fence = ts.fences[ts.region];
+        if(fence != nullptr) {
+            // Issued 'texture_staging_region_count' frames ago.
+            while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000)
+                == GL_TIMEOUT_EXPIRED)
+            {}
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        auto region_offset = ts.region * ts.budget;
+        auto used = std::size_t(0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ts.staging);
+        while(not ts.uploading.empty()) {
+            auto& u = ts.uploading.front();
+            auto& h = u.cooked->header();
+            auto& level = u.cooked->levels()[u.level];
+            auto blocks = u.cooked->blocks(level);
+            auto level_block_rows = image::block_count(int(level.height));
+            auto row_size = std::size_t(image::block_count(int(level.width)))
+                * image::block_bytes(h.format);
+            // At least a block row, even if over budget.
+            auto rows = std::min(
+                int((ts.budget - used) / row_size),
+                level_block_rows - u.block_row);
+            if(rows == 0) {
+                if(used > 0) {
+                    break;
+                }
+                rows = 1;
+            }
+            auto bytes = row_size * std::size_t(rows);
+            auto first = blocks.data() + row_size * std::size_t(u.block_row);
+            auto y = 4 * u.block_row;
+            auto& array = arrays.arrays[u.layer.array].texture;
+            auto height = std::min(4 * rows, int(level.height) - y);
+            if(bytes > ts.budget - used) {
+                // A single block row larger than the budget, uploaded directly.
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glCompressedTextureSubImage3D(array, GLint(u.level),
+                    0, y, GLint(u.layer.layer),
+                    GLsizei(level.width), height, 1, internal_format(h.format),
+                    GLsizei(bytes), first);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ts.staging);
+            } else {
+                std::memcpy(ts.mapped + region_offset + used, first, bytes);
+                glCompressedTextureSubImage3D(array, GLint(u.level),
+                    0, y, GLint(u.layer.layer),
+                    GLsizei(level.width), height, 1, internal_format(h.format),
+                    GLsizei(bytes), reinterpret_cast<const void*>(region_offset + used));
+            }
+            used += bytes;
+            ts.uploaded_bytes += bytes;
+            u.block_row += rows;
+            if(u.block_row == level_block_rows) {
+                u.block_row = 0;
+                u.level += 1;
+            }
+            if(u.level == h.level_count) {
+                textures[u.texture].layer = u.layer;
+                ts.resident_count += 1;
+                ts.uploading.pop_front();
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    if(not is_streaming(ts)) {
+        ts.seconds = ts.clock.restart().count();
+        std::cout << "Textures: " << ts.resident_count << " resident"
+            << ", " << ts.failed_count << " failed"
+            << ", " << ts.cache_hit_count << " cache hits"
+            << ", " << float(ts.file_bytes) / float(1 << 20) << " MiB read"
+            << ", " << float(ts.uploaded_bytes) / float(1 << 20) << " MiB uploaded"
+            << " (RGBA8: " << float(ts.rgba8_bytes) / float(1 << 20) << " MiB)"
+            << " in " << 1000.f * ts.seconds << " ms"
+            << " (" << throughput(ts) << " MB/s).\n";
+    }
+}